@@ -0,0 +1,141 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "connection.h"
+#include "resultset.h"
+
+namespace SmartSqlite {
+
+// called on the worker thread; exception is nullptr on success
+using CompletionCallback = std::function<void(std::exception_ptr exception)>;
+
+/**
+ * @brief Runs a Connection on a dedicated worker thread.
+ *
+ * The connection is opened, used and closed exclusively by the worker. Work
+ * submitted from any thread is executed in submission order. Whenever the
+ * worker wakes up, it takes all queued work at once and runs it back to back,
+ * so a burst of submissions is processed without a thread handoff between
+ * the items.
+ *
+ * Results and exceptions are delivered through futures or, using post(),
+ * through completion callbacks. The destructor finishes all queued work.
+ */
+class AsyncConnection
+{
+public:
+    // throws if the connection can't be opened
+    explicit AsyncConnection(const std::string &connectionString);
+    ~AsyncConnection();
+
+    /**
+     * @brief Runs work(Connection &) on the worker thread.
+     *
+     * The returned future provides the result of work or the exception it
+     * has thrown. Objects obtained from the connection, such as statements
+     * or rows, must not escape work.
+     */
+    template <typename Work>
+    auto submit(Work work) -> std::future<decltype(work(std::declval<Connection &>()))>
+    {
+        using Result = decltype(work(std::declval<Connection &>()));
+        auto task = std::make_shared<std::packaged_task<Result(Connection &)>>(std::move(work));
+        auto future = task->get_future();
+        enqueue([task](Connection &conn) { (*task)(conn); });
+        return future;
+    }
+
+    // runs work and invokes done afterwards, both on the worker thread;
+    // done must not throw
+    void post(std::function<void(Connection &)> work, CompletionCallback done = nullptr);
+
+    // Connection::exec() on the worker thread
+    std::future<void> exec(std::string sql);
+
+    // runs a single statement and returns all of its results
+    std::future<ResultSet> query(std::string sql);
+
+    /**
+     * @brief Runs work inside a transaction.
+     *
+     * The transaction is committed if work returns normally, and rolled
+     * back if it throws.
+     */
+    template <typename Work>
+    auto transaction(Work work, TransactionType type = Deferred)
+        -> std::future<decltype(work(std::declval<Connection &>()))>
+    {
+        using Result = decltype(work(std::declval<Connection &>()));
+        return submit([work, type](Connection &conn) mutable -> Result {
+            conn.beginTransaction(type);
+            return TransactionGuard<Result>::run(conn, work);
+        });
+    }
+
+private:
+    // AsyncConnection is neither copyable nor movable
+    AsyncConnection(const AsyncConnection &) = delete;
+    AsyncConnection &operator=(const AsyncConnection &) = delete;
+
+    void enqueue(std::function<void(Connection &)> work);
+
+    // runs work, then commits; rolls back if work throws
+    template <typename Result>
+    struct TransactionGuard
+    {
+        template <typename Work>
+        static Result run(Connection &conn, Work &work)
+        {
+            try
+            {
+                Result result = work(conn);
+                conn.commitTransaction();
+                return result;
+            }
+            catch (...)
+            {
+                rollback(conn);
+                throw;
+            }
+        }
+    };
+
+    static void rollback(Connection &conn);
+
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+template <>
+struct AsyncConnection::TransactionGuard<void>
+{
+    template <typename Work>
+    static void run(Connection &conn, Work &work)
+    {
+        try
+        {
+            work(conn);
+            conn.commitTransaction();
+        }
+        catch (...)
+        {
+            rollback(conn);
+            throw;
+        }
+    }
+};
+
+}
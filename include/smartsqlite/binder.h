@@ -6,9 +6,12 @@
  */
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include "views.h"
+
 struct sqlite3_stmt;
 
 namespace SmartSqlite {
@@ -19,7 +22,23 @@ public:
     static int bindLongLong(sqlite3_stmt *stmt, int pos, long long value);
     static int bindDouble(sqlite3_stmt *stmt, int pos, double value);
     static int bindString(sqlite3_stmt *stmt, int pos, const std::string &value);
+    // null-terminated string, nullptr is bound as NULL
+    static int bindString(sqlite3_stmt *stmt, int pos, const char *value);
     static int bindBlob(sqlite3_stmt *stmt, int pos, const void *data, size_t size);
+
+    // Borrowing binders: data is not copied, so the caller must keep it alive
+    // and unchanged until the parameter is rebound or the bindings are cleared.
+    static int bindStaticString(sqlite3_stmt *stmt, int pos, const char *data, size_t size);
+    static int bindStaticBlob(sqlite3_stmt *stmt, int pos, const void *data, size_t size);
+
+    // Array parameters for the carray() table-valued function. The borrowing
+    // variants don't copy the values, see Binder<std::vector<std::int64_t>>.
+    static int bindInt64Array(sqlite3_stmt *stmt, int pos, const std::int64_t *data, size_t size);
+    static int bindDoubleArray(sqlite3_stmt *stmt, int pos, const double *data, size_t size);
+    static int bindTextArray(sqlite3_stmt *stmt, int pos, const std::string *data, size_t size);
+    static int bindInt64Array(sqlite3_stmt *stmt, int pos, std::vector<std::int64_t> &&values);
+    static int bindDoubleArray(sqlite3_stmt *stmt, int pos, std::vector<double> &&values);
+    static int bindTextArray(sqlite3_stmt *stmt, int pos, std::vector<std::string> &&values);
 };
 
 // extension point: specialize this to add support for custom types
@@ -40,6 +59,31 @@ public:
     }
 };
 
+template <>
+class Binder<const char *>
+{
+public:
+    static int bind(sqlite3_stmt *stmt, int pos, const char *value)
+    {
+        return NativeBinder::bindString(stmt, pos, value);
+    }
+};
+
+template <>
+class Binder<char *> : public Binder<const char *>
+{
+};
+
+template <>
+class Binder<StringView>
+{
+public:
+    static int bind(sqlite3_stmt *stmt, int pos, const StringView &value)
+    {
+        return NativeBinder::bindStaticString(stmt, pos, value.data(), value.size());
+    }
+};
+
 template <>
 class Binder<void*, std::size_t>
 {
@@ -60,4 +104,49 @@ public:
     }
 };
 
+template <>
+class Binder<BlobView>
+{
+public:
+    static int bind(sqlite3_stmt *stmt, int pos, const BlobView &value)
+    {
+        return NativeBinder::bindStaticBlob(stmt, pos, value.data(), value.size());
+    }
+};
+
+// Array parameters for the carray() table-valued function that every
+// Connection registers, e.g. "SELECT * FROM foo WHERE id IN carray(?)".
+// The values are not copied, so the vector must stay alive and unchanged
+// until the parameter is rebound or the bindings are cleared. Bind an rvalue
+// to move the vector into the binding instead.
+template <>
+class Binder<std::vector<std::int64_t>>
+{
+public:
+    static int bind(sqlite3_stmt *stmt, int pos, const std::vector<std::int64_t> &values)
+    {
+        return NativeBinder::bindInt64Array(stmt, pos, values.data(), values.size());
+    }
+};
+
+template <>
+class Binder<std::vector<double>>
+{
+public:
+    static int bind(sqlite3_stmt *stmt, int pos, const std::vector<double> &values)
+    {
+        return NativeBinder::bindDoubleArray(stmt, pos, values.data(), values.size());
+    }
+};
+
+template <>
+class Binder<std::vector<std::string>>
+{
+public:
+    static int bind(sqlite3_stmt *stmt, int pos, const std::vector<std::string> &values)
+    {
+        return NativeBinder::bindTextArray(stmt, pos, values.data(), values.size());
+    }
+};
+
 }
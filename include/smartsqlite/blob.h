@@ -20,6 +20,7 @@ public:
     enum Flags { READONLY = 0, READWRITE = 1 };
 
     explicit Blob(sqlite3 *conn, sqlite3_blob *blob);
+    // a moved-from Blob may only be destroyed or assigned to
     Blob(Blob &&other);
     Blob &operator=(Blob &&rhs);
     ~Blob();
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace SmartSqlite {
+
+// return true to try again, false to fail with SQLITE_BUSY; count is the
+// number of times the callback has been called for the same lock
+using BusyCallback = bool(void *extraArg, int count);
+
+/**
+ * @brief Parameters for Connection::setBusyBackoff().
+ *
+ * The n-th wait sleeps initialDelay * multiplier^n, capped at maxDelay and
+ * scaled by a random factor between 0.5 and 1 so that competing
+ * connections don't retry in lockstep.
+ */
+struct BusyBackoff
+{
+    std::chrono::microseconds initialDelay = std::chrono::microseconds(100);
+    std::chrono::microseconds maxDelay = std::chrono::milliseconds(50);
+    double multiplier = 2.0;
+    // give up waiting for a lock after this time
+    std::chrono::milliseconds timeout = std::chrono::seconds(5);
+};
+
+struct BusyStats
+{
+    // calls of the busy handler
+    std::uint64_t invocations = 0;
+    // lock acquisitions that had to wait
+    std::uint64_t waits = 0;
+    // waits that gave up with SQLITE_BUSY
+    std::uint64_t timeouts = 0;
+    std::chrono::nanoseconds blockedTime = std::chrono::nanoseconds::zero();
+    // waits by duration, see bucketLimit()
+    std::array<std::uint64_t, 8> histogram = {{}};
+
+    // histogram[i] counts waits shorter than bucketLimit(i) that don't fit
+    // into a lower bucket: 1 ms, 4 ms, 16 ms, ...; the last one is unbounded
+    static std::chrono::milliseconds bucketLimit(std::size_t bucket)
+    {
+        return bucket + 1 < std::tuple_size<decltype(histogram)>::value
+                ? std::chrono::milliseconds(1LL << (2 * bucket))
+                : std::chrono::milliseconds::max();
+    }
+};
+
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "connection.h"
+
+namespace SmartSqlite {
+
+struct CheckpointPolicy
+{
+    // PASSIVE checkpoint once this many frames haven't been checkpointed
+    int passiveFrames = 1000;
+    // RESTART checkpoint once the WAL has grown to this many frames,
+    // e.g. because long-running readers prevented earlier checkpoints
+    int restartFrames = 10000;
+    // RESTART checkpoints block writers while they wait for readers, so
+    // after one was starved by readers, only PASSIVE checkpoints run for
+    // this long
+    std::chrono::milliseconds restartBackoff = std::chrono::seconds(1);
+    // TRUNCATE checkpoint when there was no commit for this long
+    std::chrono::milliseconds idleTime = std::chrono::seconds(1);
+    // how long RESTART and TRUNCATE checkpoints wait for other connections
+    int busyTimeoutMs = 100;
+};
+
+struct CheckpointStats
+{
+    // checkpoints run, by mode
+    std::uint64_t passive = 0;
+    std::uint64_t restart = 0;
+    std::uint64_t truncate = 0;
+    std::uint64_t framesCheckpointed = 0;
+    // checkpoints that couldn't copy all frames or restart the WAL because
+    // other connections were using it
+    std::uint64_t starved = 0;
+    // checkpoints that failed with an error other than SQLITE_BUSY
+    std::uint64_t failed = 0;
+    // WAL size as last reported by a commit or checkpoint
+    int walFrames = 0;
+    int maxWalFrames = 0;
+};
+
+/**
+ * @brief Runs WAL checkpoints on a background thread.
+ *
+ * Without it, SQLite checkpoints on whichever connection commits when the
+ * WAL has grown past wal_autocheckpoint, which delays that commit.
+ *
+ * Connections that are attached report their commits through the WAL hook,
+ * which replaces their automatic checkpoints. The scheduler checkpoints
+ * from its own connection: PASSIVE once enough frames have accumulated,
+ * RESTART when the WAL keeps growing (but not again right after readers
+ * starved one), and TRUNCATE after the database has been idle for a while.
+ */
+class CheckpointScheduler
+{
+public:
+    // filename must refer to a database in WAL mode
+    explicit CheckpointScheduler(
+            const std::string &filename,
+            CheckpointPolicy policy = CheckpointPolicy());
+    ~CheckpointScheduler();
+
+    /**
+     * @brief Disables automatic checkpoints on conn and reports its commits
+     * to this scheduler.
+     *
+     * conn must be detached or destroyed before the scheduler.
+     */
+    void attach(Connection &conn);
+
+    // restores the default automatic checkpoints
+    static void detach(Connection &conn);
+
+    CheckpointStats stats() const;
+
+private:
+    // CheckpointScheduler is neither copyable nor movable
+    CheckpointScheduler(const CheckpointScheduler &) = delete;
+    CheckpointScheduler &operator=(const CheckpointScheduler &) = delete;
+
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "views.h"
+
+struct sqlite3_stmt;
+
+namespace SmartSqlite {
+
+/**
+ * @brief A batch of result rows, stored column by column.
+ *
+ * Filled by Statement::fetchColumns(). Every column has a fixed type, which
+ * is derived from the declared type of the column or, for expressions, from
+ * the first value in the result that isn't NULL. Values of other types are
+ * converted by SQLite, NULL is stored as 0 or as an empty string and flagged
+ * in the null bitmap.
+ *
+ * When a batch is reused for further fetches of a statement with the same
+ * column names and declared types, its buffers keep their capacity and its
+ * column types stay the same.
+ */
+class ColumnBatch
+{
+public:
+    enum struct Type {Int64, Double, Text, Blob};
+
+    class Column
+    {
+    public:
+        Type type() const
+        {
+            return m_type;
+        }
+
+        const std::string &name() const
+        {
+            return m_name;
+        }
+
+        // values of Int64 columns
+        const std::vector<std::int64_t> &int64s() const
+        {
+            return m_int64s;
+        }
+
+        // values of Double columns
+        const std::vector<double> &doubles() const
+        {
+            return m_doubles;
+        }
+
+        // Text and Blob columns: value i is stored in
+        // bytes()[offsets()[i]] to bytes()[offsets()[i + 1]] (exclusive)
+        const std::vector<std::size_t> &offsets() const
+        {
+            return m_offsets;
+        }
+
+        const std::vector<unsigned char> &bytes() const
+        {
+            return m_bytes;
+        }
+
+        // bit (row % 8) of byte (row / 8) is set if the value is NULL
+        const std::vector<std::uint8_t> &nullBitmap() const
+        {
+            return m_nullBitmap;
+        }
+
+        bool isNull(std::size_t row) const
+        {
+            return (m_nullBitmap[row / 8] >> (row % 8)) & 1u;
+        }
+
+        StringView text(std::size_t row) const
+        {
+            return StringView(
+                        reinterpret_cast<const char*>(m_bytes.data()) + m_offsets[row],
+                        m_offsets[row + 1] - m_offsets[row]);
+        }
+
+        BlobView blob(std::size_t row) const
+        {
+            return BlobView(
+                        m_bytes.data() + m_offsets[row],
+                        m_offsets[row + 1] - m_offsets[row]);
+        }
+
+    private:
+        void clear();
+        void append(sqlite3_stmt *stmt, int pos, std::size_t row);
+        // sets the type from the first value that isn't NULL
+        void inferType(sqlite3_stmt *stmt, int pos);
+
+        Type m_type = Type::Text;
+        // false while only NULL values of an untyped column have been seen
+        bool m_typeKnown = true;
+        std::string m_name;
+        std::string m_declaredType;
+        std::vector<std::int64_t> m_int64s;
+        std::vector<double> m_doubles;
+        std::vector<std::size_t> m_offsets;
+        std::vector<unsigned char> m_bytes;
+        std::vector<std::uint8_t> m_nullBitmap;
+
+        friend class ColumnBatch;
+    };
+
+    std::size_t rows() const
+    {
+        return m_rows;
+    }
+
+    std::size_t columnCount() const
+    {
+        return m_columns.size();
+    }
+
+    const Column &column(std::size_t pos) const
+    {
+        return m_columns.at(pos);
+    }
+
+private:
+    void clear();
+    // derives the column types from stmt, which must point to a result row
+    void setColumns(sqlite3_stmt *stmt);
+    bool hasColumns(sqlite3_stmt *stmt) const;
+    void append(sqlite3_stmt *stmt);
+
+    std::vector<Column> m_columns;
+    std::size_t m_rows = 0;
+
+    friend class Statement;
+};
+
+}
@@ -6,11 +6,18 @@
  */
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "blob.h"
+#include "busyhandler.h"
+#include "connectionoptions.h"
+#include "script.h"
 #include "statement.h"
+#include "statementcache.h"
+#include "staticsql.h"
 
 struct sqlite3;
 
@@ -23,8 +30,51 @@ enum TransactionType
     Exclusive
 };
 
+// flags for Connection::prepare(), can be combined using bitwise or
+enum PrepareFlags
+{
+    // statement will be reused many times; keep it out of lookaside memory
+    PreparePersistent = 0x01,
+    // fail to prepare statements that use virtual tables
+    PrepareNoVtab = 0x04
+};
+
+enum CheckpointMode
+{
+    // copy as many frames as possible without waiting for other connections
+    CheckpointPassive = 0,
+    // wait for writers, then copy all frames
+    CheckpointFull = 1,
+    // like Full, then wait for readers so that the WAL can be restarted
+    CheckpointRestart = 2,
+    // like Restart, then truncate the WAL file to zero bytes
+    CheckpointTruncate = 3
+};
+
+struct CheckpointResult
+{
+    // the checkpoint couldn't be completed because of other connections
+    bool busy = false;
+    // size of the WAL in frames, -1 if the database is not in WAL mode
+    int walFrames = 0;
+    // frames of the WAL that are in the database file
+    int checkpointedFrames = 0;
+};
+
+enum SerializeMode
+{
+    // the pages as read by SQLite, i.e. decrypted if the database has a key
+    SerializePlaintext,
+    // the database file as stored, i.e. encrypted if the database has a key
+    SerializeStored
+};
+
 using TracingCallback = void(void *extraArg, const char *sql);
 using ProfilingCallback = void(void *extraArg, const char *sql, std::uint64_t nanos);
+// return false to interrupt the running statement
+using ProgressCallback = bool(void *extraArg);
+// called after each commit in WAL mode; must return SQLITE_OK
+using WalCallback = int(void *extraArg, sqlite3 *db, const char *schema, int walFrames);
 
 // MSVC 2013 doesn't like "using" in this case, so we resort to plain old typedef
 typedef void(Sqlite3Deleter)(sqlite3*);
@@ -33,15 +83,100 @@ class Connection
 {
 public:
     Connection(const std::string &connectionString);
+    // opens using sqlite3_open_v2() and applies the options' pragmas
+    Connection(const std::string &connectionString, const ConnectionOptions &options);
     Connection(Connection &&other);
     Connection &operator=(Connection &&rhs);
     ~Connection();
 
+    // setBusyTimeout(), setBusyHandler() and setBusyBackoff() replace each other
     void setBusyTimeout(int ms);
+
+    // calls callback when a lock can't be acquired, nullptr removes it
+    void setBusyHandler(BusyCallback *callback, void *extraArg = nullptr);
+
+    /**
+     * @brief Waits for locks using exponential backoff with jitter.
+     *
+     * Gives up when backoff.timeout has passed or at the deadline set by
+     * setDeadline(), whichever comes first.
+     */
+    void setBusyBackoff(const BusyBackoff &backoff = BusyBackoff());
+
+    // Lock contention seen by setBusyHandler() and setBusyBackoff(). May be
+    // called from another thread.
+    BusyStats busyStats() const;
+
     void *setTracingCallback(TracingCallback *callback, void *extraArg = nullptr);
     void *setProfilingCallback(ProfilingCallback *callback, void *extraArg = nullptr);
+
+    /**
+     * @brief Makes the running statement fail with Interrupted.
+     *
+     * This is the only method that may be called from another thread while
+     * the connection is in use. It has no effect if no statement is running.
+     */
+    void interrupt();
+
+    /**
+     * @brief Calls callback every `instructions` virtual machine instructions
+     * while statements are running.
+     *
+     * Returning false from the callback interrupts the statement. Pass
+     * nullptr to remove the callback.
+     */
+    void setProgressCallback(
+            ProgressCallback *callback,
+            void *extraArg = nullptr,
+            int instructions = 1000);
+
+    // statements that are still running after deadline are interrupted
+    void setDeadline(std::chrono::steady_clock::time_point deadline);
+    void clearDeadline();
     Statement prepare(const std::string &sql);
+    Statement prepare(const std::string &sql, unsigned int flags);
+
+    // prepare SMARTSQLITE_SQL("...") for compile-time parameter count checks
+    template <int ParameterCount>
+    CheckedStatement<ParameterCount> prepare(const StaticSql<ParameterCount> &sql)
+    {
+        return CheckedStatement<ParameterCount>(prepare(sql.text()));
+    }
+
+    /**
+     * @brief Runs one or more SQL statements, ignoring returned rows.
+     *
+     * SQL that consists of a single statement is kept compiled in a small
+     * cache of its own, so that repeated calls don't compile it again. It
+     * doesn't take up room in the statement cache of prepareCached(). The
+     * statements of multi-statement SQL are compiled for a single run; use
+     * prepareScript() for such SQL if it is run repeatedly.
+     */
     void exec(const std::string &sql);
+    // like exec(sql), but callback is invoked for every returned row
+    void exec(const std::string &sql, const RowCallback &callback);
+    Script prepareScript(const std::string &sql);
+
+    /**
+     * @brief Like prepare(), but reuses idle statements with the same SQL.
+     *
+     * The returned statement goes back to the connection's LRU statement cache
+     * when it is destroyed. It is reset and its bindings are cleared then.
+     * Cached statements are always prepared with PreparePersistent.
+     */
+    Statement prepareCached(const std::string &sql);
+
+    template <int ParameterCount>
+    CheckedStatement<ParameterCount> prepareCached(const StaticSql<ParameterCount> &sql)
+    {
+        return CheckedStatement<ParameterCount>(prepareCached(sql.text()));
+    }
+    void setStatementCacheCapacity(std::size_t capacity);
+    StatementCacheStats statementCacheStats() const;
+    // stats of the cache that exec() uses for single statements
+    StatementCacheStats execCacheStats() const;
+    // finalizes the idle statements of both caches
+    void clearStatementCache();
 
     void setKey(const std::string &keyBase64);
     void changeKey(const std::string &keyBase64);
@@ -53,10 +188,48 @@ public:
     void savepoint(const std::string &name);
     void releaseSavepoint(const std::string &name);
     void rollbackToSavepoint(const std::string &name);
+    // false while a transaction is active; SQLite may end a transaction
+    // itself, e.g. for ON CONFLICT ROLLBACK or after an I/O error
+    bool isAutocommit() const;
 
     std::int64_t lastInsertRowId() const;
     int changes() const;
 
+    // Automatic checkpoints and the WAL hook replace each other. Passing 0
+    // disables automatic checkpoints.
+    void setWalAutocheckpoint(int frames);
+    void *setWalHook(WalCallback *callback, void *extraArg = nullptr);
+
+    // checkpoints the given schema, or all attached databases if it's empty
+    CheckpointResult checkpoint(
+            CheckpointMode mode = CheckpointPassive,
+            const std::string &schema = "");
+
+    /**
+     * @brief Returns the content of a database as it would be stored in a file.
+     *
+     * With SerializePlaintext, pages are read through SQLite, so a database
+     * encrypted using setKey() is exported as plaintext. SerializeStored
+     * copies the database file as it is, e.g. for an encrypted backup. It
+     * requires a database file that isn't in WAL mode and that no
+     * transaction is active.
+     */
+    std::vector<unsigned char> serialize(
+            const std::string &schema = "main",
+            SerializeMode mode = SerializePlaintext);
+
+    /**
+     * @brief Replaces a database with an in-memory copy of buffer.
+     *
+     * buffer is copied, it can be discarded after the call. Unless readOnly
+     * is set, the in-memory database can be modified and grow. buffer must
+     * contain plaintext; encrypted databases can't be loaded this way.
+     */
+    void deserialize(
+            const std::vector<unsigned char> &buffer,
+            bool readOnly,
+            const std::string &schema = "main");
+
     Blob openBlob(
             const std::string &db,
             const std::string &table,
@@ -65,9 +238,22 @@ public:
             Blob::Flags flags);
 
 private:
+    struct ProgressState;
+    struct BusyState;
+
     static std::string escape(const std::string &original);
+    static std::string quoteIdentifier(const std::string &original);
+    void updateProgressHandler();
+    void installBusyHandler(BusyCallback *callback, void *extraArg);
+    sqlite3_stmt *prepareHandle(const std::string &sql, unsigned int flags);
+    std::vector<unsigned char> serializeStored(const std::string &schema);
 
     std::unique_ptr<sqlite3, Sqlite3Deleter*> conn_;
+    std::shared_ptr<StatementCache> stmtCache_;
+    std::unique_ptr<StatementCache> execCache_;
+    // heap allocated so that its address, which SQLite keeps, survives moves
+    std::unique_ptr<ProgressState> progress_;
+    std::unique_ptr<BusyState> busy_;
 };
 
 }
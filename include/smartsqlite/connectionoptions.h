@@ -0,0 +1,97 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "nullable.h"
+
+namespace SmartSqlite {
+
+// flags for ConnectionOptions::flags, can be combined using bitwise or
+enum OpenFlags
+{
+    OpenReadOnly = 0x00000001,
+    OpenReadWrite = 0x00000002,
+    OpenCreate = 0x00000004,
+    OpenUri = 0x00000040,
+    OpenMemory = 0x00000080,
+    // the connection must only be used by one thread at a time
+    OpenNoMutex = 0x00008000,
+    OpenFullMutex = 0x00010000,
+    OpenSharedCache = 0x00020000,
+    OpenPrivateCache = 0x00040000
+};
+
+enum JournalMode
+{
+    JournalModeUnchanged,
+    JournalModeDelete,
+    JournalModeTruncate,
+    JournalModePersist,
+    JournalModeMemory,
+    JournalModeWal,
+    JournalModeOff
+};
+
+enum Synchronous
+{
+    SynchronousUnchanged,
+    SynchronousOff,
+    SynchronousNormal,
+    SynchronousFull,
+    SynchronousExtra
+};
+
+enum TempStore
+{
+    TempStoreUnchanged,
+    TempStoreDefault,
+    TempStoreFile,
+    TempStoreMemory
+};
+
+/**
+ * @brief How a Connection is opened and configured.
+ *
+ * Settings that are left unchanged (null or *Unchanged) keep SQLite's
+ * defaults. All pragmas are sent to SQLite in a single exec() right after
+ * opening, page_size first so that it takes effect before the journal mode
+ * is changed.
+ */
+struct ConnectionOptions
+{
+    // combination of OpenFlags; the default matches sqlite3_open()
+    int flags = OpenReadWrite | OpenCreate;
+    // name of the VFS to use, empty for the default VFS
+    std::string vfs;
+
+    Nullable<int> busyTimeoutMs;
+    Nullable<int> pageSize;
+    JournalMode journalMode = JournalModeUnchanged;
+    Synchronous synchronous = SynchronousUnchanged;
+    // positive: number of pages, negative: size in KiB
+    Nullable<int> cacheSize;
+    Nullable<std::int64_t> mmapSize;
+    TempStore tempStore = TempStoreUnchanged;
+
+    // WAL, relaxed syncing, a large cache and memory-mapped reads
+    static ConnectionOptions readHeavyWal();
+
+    // for filling a database from scratch: no syncing and an in-memory
+    // journal; the database may be corrupted if the system crashes
+    static ConnectionOptions bulkLoad();
+
+    // a small cache and no memory mapping; temporary data goes to disk
+    static ConnectionOptions lowMemory();
+
+    // the pragmas that are executed on open, empty if there are none
+    std::string pragmas() const;
+};
+
+}
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "connection.h"
+
+namespace SmartSqlite {
+
+class ConnectionPool;
+
+struct ConnectionPoolStats
+{
+    std::uint64_t readerCheckouts = 0;
+    std::uint64_t writerCheckouts = 0;
+    // checkouts that had to wait for a connection to be returned
+    std::uint64_t readerWaits = 0;
+    std::uint64_t writerWaits = 0;
+    std::chrono::nanoseconds readerWaitTime = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds writerWaitTime = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds maxWaitTime = std::chrono::nanoseconds::zero();
+};
+
+/**
+ * @brief A connection checked out of a ConnectionPool.
+ *
+ * The connection goes back to the pool when the handle is destroyed. The
+ * pool must outlive all of its handles.
+ */
+class PooledConnection
+{
+public:
+    PooledConnection(PooledConnection &&other);
+    PooledConnection &operator=(PooledConnection &&rhs);
+    ~PooledConnection();
+
+    Connection &operator*() const
+    {
+        return *m_conn;
+    }
+
+    Connection *operator->() const
+    {
+        return m_conn;
+    }
+
+    bool isWriter() const
+    {
+        return m_isWriter;
+    }
+
+    // time spent waiting for the connection to become available
+    std::chrono::nanoseconds waitTime() const
+    {
+        return m_waitTime;
+    }
+
+private:
+    PooledConnection(
+            ConnectionPool *pool,
+            Connection *conn,
+            bool isWriter,
+            std::chrono::nanoseconds waitTime);
+
+    // PooledConnection is not copyable
+    PooledConnection(const PooledConnection &) = delete;
+    PooledConnection &operator=(const PooledConnection &) = delete;
+
+    ConnectionPool *m_pool;
+    Connection *m_conn;
+    bool m_isWriter;
+    std::chrono::nanoseconds m_waitTime;
+
+    friend class ConnectionPool;
+};
+
+// A statement together with the pooled connection it was prepared on
+class PooledStatement
+{
+public:
+    PooledStatement(PooledStatement &&other) = default;
+
+    Statement &operator*()
+    {
+        return m_stmt;
+    }
+
+    Statement *operator->()
+    {
+        return &m_stmt;
+    }
+
+    const PooledConnection &connection() const
+    {
+        return m_conn;
+    }
+
+private:
+    PooledStatement(PooledConnection conn, Statement stmt);
+
+    // declared first so that the statement is destroyed before the
+    // connection goes back to the pool
+    PooledConnection m_conn;
+    Statement m_stmt;
+
+    friend class ConnectionPool;
+};
+
+/**
+ * @brief One writer and several reader connections to one database file.
+ *
+ * The database is switched to WAL mode, so the writer never blocks the
+ * readers. Readers are opened read-only and without SQLite's connection
+ * mutex, since a checked out connection belongs to one thread. Checkouts
+ * block until a connection of the requested kind is available.
+ */
+class ConnectionPool
+{
+public:
+    ConnectionPool(const std::string &filename, std::size_t readers);
+    ~ConnectionPool();
+
+    PooledConnection reader();
+    PooledConnection writer();
+
+    /**
+     * @brief Prepares sql on a reader if it is read-only, else on the writer.
+     *
+     * The routing decision is made once per SQL text using
+     * sqlite3_stmt_readonly() on the first idle connection and then
+     * remembered. Statements are prepared using the statement cache of the
+     * chosen connection.
+     */
+    PooledStatement prepare(const std::string &sql);
+
+    ConnectionPoolStats stats() const;
+
+private:
+    // ConnectionPool is neither copyable nor movable
+    ConnectionPool(const ConnectionPool &) = delete;
+    ConnectionPool &operator=(const ConnectionPool &) = delete;
+
+    enum Kind
+    {
+        ReaderKind,
+        WriterKind,
+        // whichever is available first
+        AnyKind
+    };
+    PooledConnection checkout(Kind kind);
+    void checkin(Connection *conn, bool isWriter);
+
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+
+    friend class PooledConnection;
+};
+
+}
@@ -6,6 +6,7 @@
  */
 #pragma once
 
+#include <cstddef>
 #include <exception>
 #include <string>
 
@@ -27,6 +28,18 @@ public:
     ParameterUnknown(const std::string &parameter);
 };
 
+class ParameterCountMismatch : public Exception
+{
+public:
+    ParameterCountMismatch(int expected, std::size_t actual, const std::string &sql = "");
+};
+
+class ColumnCountMismatch : public Exception
+{
+public:
+    ColumnCountMismatch(std::size_t expected, int actual, const std::string &sql = "");
+};
+
 class ColumnUnknown : public Exception
 {
 public:
@@ -46,6 +59,12 @@ public:
     QueryReturnedNoRows(const std::string &sql = "");
 };
 
+class BorrowedBindingModified : public Exception
+{
+public:
+    BorrowedBindingModified(int parameterPos, const std::string &sql = "");
+};
+
 class SqliteException : public Exception
 {
 public:
@@ -53,6 +72,14 @@ public:
     SqliteException(const std::string &func, int resultCode, const std::string &message);
 };
 
+// thrown for SQLITE_INTERRUPT, i.e. after Connection::interrupt(), an
+// expired deadline or a progress callback that requested an interruption
+class Interrupted : public SqliteException
+{
+public:
+    using SqliteException::SqliteException;
+};
+
 class FeatureUnavailable : public Exception
 {
 public:
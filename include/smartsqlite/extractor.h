@@ -9,6 +9,8 @@
 #include <string>
 #include <vector>
 
+#include "views.h"
+
 struct sqlite3_stmt;
 
 namespace SmartSqlite {
@@ -20,6 +22,15 @@ public:
     static double extractDouble(sqlite3_stmt *stmt, int pos);
     static std::string extractString(sqlite3_stmt *stmt, int pos);
     static std::vector<unsigned char> extractBlob(sqlite3_stmt *stmt, int pos);
+
+    // The views point into memory owned by SQLite. They are only valid until
+    // the statement is stepped, reset or finalized.
+    static StringView extractStringView(sqlite3_stmt *stmt, int pos);
+    static BlobView extractBlobView(sqlite3_stmt *stmt, int pos);
+
+    // overwrite target, reusing its capacity
+    static void extractStringInto(sqlite3_stmt *stmt, int pos, std::string &target);
+    static void extractBlobInto(sqlite3_stmt *stmt, int pos, std::vector<unsigned char> &target);
 };
 
 // extension point: specialize this to add support for custom types
@@ -50,4 +61,56 @@ public:
     }
 };
 
+template <>
+class Extractor<StringView>
+{
+public:
+    static StringView extract(sqlite3_stmt *stmt, int pos)
+    {
+        return NativeExtractor::extractStringView(stmt, pos);
+    }
+};
+
+template <>
+class Extractor<BlobView>
+{
+public:
+    static BlobView extract(sqlite3_stmt *stmt, int pos)
+    {
+        return NativeExtractor::extractBlobView(stmt, pos);
+    }
+};
+
+// extension point for Row::getInto(): specialize this for types that can
+// reuse resources of an existing object
+template <typename T>
+class IntoExtractor
+{
+public:
+    static void extractInto(sqlite3_stmt *stmt, int pos, T &target)
+    {
+        target = Extractor<T>::extract(stmt, pos);
+    }
+};
+
+template <>
+class IntoExtractor<std::string>
+{
+public:
+    static void extractInto(sqlite3_stmt *stmt, int pos, std::string &target)
+    {
+        NativeExtractor::extractStringInto(stmt, pos, target);
+    }
+};
+
+template <>
+class IntoExtractor<std::vector<unsigned char>>
+{
+public:
+    static void extractInto(sqlite3_stmt *stmt, int pos, std::vector<unsigned char> &target)
+    {
+        NativeExtractor::extractBlobInto(stmt, pos, target);
+    }
+};
+
 }
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+namespace SmartSqlite {
+
+/**
+ * @brief Extension point: maps a struct to a tuple of its fields.
+ *
+ * Specialize this to pass custom structs as rows to
+ * Statement::executeMany(). tie() must return a tuple of (references to) the
+ * values in parameter order:
+ *
+ *     template <>
+ *     class Fields<Person>
+ *     {
+ *     public:
+ *         static std::tuple<const std::int64_t &, const std::string &>
+ *         tie(const Person &person)
+ *         {
+ *             return std::tie(person.id, person.name);
+ *         }
+ *     };
+ *
+ * To read results into the struct using Statement::rowsAs(), additionally
+ * provide a non-const overload returning a tuple of mutable references in
+ * column order.
+ */
+template <typename T>
+class Fields;
+
+template <typename... T>
+class Fields<std::tuple<T...>>
+{
+public:
+    static const std::tuple<T...> &tie(const std::tuple<T...> &value)
+    {
+        return value;
+    }
+
+    static std::tuple<T...> &tie(std::tuple<T...> &value)
+    {
+        return value;
+    }
+};
+
+template <typename T1, typename T2>
+class Fields<std::pair<T1, T2>>
+{
+public:
+    static std::tuple<const T1 &, const T2 &> tie(const std::pair<T1, T2> &value)
+    {
+        return std::tuple<const T1 &, const T2 &>(value.first, value.second);
+    }
+
+    static std::tuple<T1 &, T2 &> tie(std::pair<T1, T2> &value)
+    {
+        return std::tuple<T1 &, T2 &>(value.first, value.second);
+    }
+};
+
+namespace Detail {
+
+// C++11 replacement for std::index_sequence
+template <std::size_t... I>
+struct IndexSequence
+{
+};
+
+template <std::size_t N, std::size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...>
+{
+};
+
+template <std::size_t... I>
+struct MakeIndexSequence<0, I...>
+{
+    using type = IndexSequence<I...>;
+};
+
+}
+
+}
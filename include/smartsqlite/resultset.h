@@ -0,0 +1,150 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "views.h"
+
+struct sqlite3_stmt;
+
+namespace SmartSqlite {
+
+/**
+ * @brief A single value of a ResultSet.
+ *
+ * Text and blob values of up to 8 bytes are stored inline, longer ones point
+ * into the arena of the ResultSet. Values must therefore not outlive the
+ * ResultSet (or the last slice of it) they were taken from.
+ */
+class Value
+{
+public:
+    enum struct Type : std::uint8_t {Null, Integer, Float, Text, Blob};
+
+    Type type() const
+    {
+        return m_type;
+    }
+
+    bool isNull() const
+    {
+        return m_type == Type::Null;
+    }
+
+    // Integer and Float values, converted if necessary; 0 for other types
+    std::int64_t toInt64() const
+    {
+        if (m_type == Type::Integer) return m_int64;
+        if (m_type == Type::Float) return static_cast<std::int64_t>(m_double);
+        return 0;
+    }
+
+    double toDouble() const
+    {
+        if (m_type == Type::Float) return m_double;
+        if (m_type == Type::Integer) return static_cast<double>(m_int64);
+        return 0;
+    }
+
+    // Text and Blob values; empty for other types
+    StringView text() const
+    {
+        return StringView(reinterpret_cast<const char*>(bytes()), byteSize());
+    }
+
+    BlobView blob() const
+    {
+        return BlobView(bytes(), byteSize());
+    }
+
+private:
+    static const std::size_t INLINE_CAPACITY = 8;
+
+    const unsigned char *bytes() const
+    {
+        if (m_type != Type::Text && m_type != Type::Blob) return nullptr;
+        return m_size <= INLINE_CAPACITY ? m_inline : m_external;
+    }
+
+    std::size_t byteSize() const
+    {
+        if (m_type != Type::Text && m_type != Type::Blob) return 0;
+        return m_size;
+    }
+
+    Type m_type = Type::Null;
+    std::uint32_t m_size = 0;
+    union
+    {
+        std::int64_t m_int64 = 0;
+        double m_double;
+        const unsigned char *m_external;
+        unsigned char m_inline[INLINE_CAPACITY];
+    };
+
+    friend class ResultSet;
+};
+
+/**
+ * @brief Owned copy of the results of a statement.
+ *
+ * Created by Statement::fetchAll(). All text and blob data is copied into an
+ * arena made of large chunks, so materializing a result takes only a few
+ * allocations and releasing it frees everything at once.
+ *
+ * A ResultSet is immutable. Copies and slices share the underlying storage,
+ * which is released together with the last ResultSet referring to it.
+ */
+class ResultSet
+{
+public:
+    ResultSet();
+
+    std::size_t rows() const
+    {
+        return m_rows;
+    }
+
+    bool empty() const
+    {
+        return m_rows == 0;
+    }
+
+    std::size_t columnCount() const;
+    const std::string &columnName(std::size_t column) const;
+
+    // throws std::out_of_range for invalid positions
+    const Value &at(std::size_t row, std::size_t column) const;
+
+    // rowCount rows starting at firstRow, sharing the storage with this result
+    ResultSet slice(std::size_t firstRow, std::size_t rowCount) const;
+
+    // bytes allocated by the storage, which may be shared with other slices
+    std::size_t memoryUsage() const;
+
+private:
+    struct Storage;
+
+    explicit ResultSet(std::shared_ptr<const Storage> storage);
+
+    // used by Statement::fetchAll()
+    static std::shared_ptr<Storage> createStorage(sqlite3_stmt *stmt);
+    static void appendRow(Storage &storage, sqlite3_stmt *stmt);
+
+    std::shared_ptr<const Storage> m_storage;
+    std::size_t m_firstRow = 0;
+    std::size_t m_rows = 0;
+
+    friend class Statement;
+};
+
+}
@@ -7,7 +7,7 @@
 #pragma once
 
 #include <iterator>
-#include <map>
+#include <string>
 #include <vector>
 
 #include "extractor.h"
@@ -19,11 +19,15 @@ struct sqlite3_stmt;
 namespace SmartSqlite {
 
 class RowIterator;
+struct StatementMetadata;
+template <typename T> class TypedRowIterator;
 
 class Row
 {
 public:
     Row(sqlite3_stmt *stmt);
+    // column names are looked up in metadata, which is shared by all rows
+    Row(sqlite3_stmt *stmt, StatementMetadata *metadata);
 
     bool isNull(int pos) const;
 
@@ -56,7 +60,9 @@ public:
     T get(int pos) const
     {
         checkPosRange(pos);
-        return Extractor<T>::extract(m_stmt, pos);
+        T value = Extractor<T>::extract(m_stmt, pos);
+        attachGuard(value);
+        return value;
     }
 
     template <typename T>
@@ -65,6 +71,29 @@ public:
         return get<T>(getPosByName(column));
     }
 
+    // Like get(), but writes into an existing object. Strings and blobs reuse
+    // the capacity of target, so no allocation is needed once it is large
+    // enough. NULL values are extracted as empty values.
+    template <typename T, typename std::enable_if<std::is_arithmetic<T>::value>::type* = nullptr>
+    void getInto(int pos, T &target) const
+    {
+        target = get<T>(pos);
+    }
+
+    template <typename T, typename std::enable_if<!std::is_arithmetic<T>::value>::type* = nullptr>
+    void getInto(int pos, T &target) const
+    {
+        checkPosRange(pos);
+        IntoExtractor<T>::extractInto(m_stmt, pos, target);
+        attachGuard(target);
+    }
+
+    template <typename T>
+    void getInto(const char *column, T &target) const
+    {
+        getInto(getPosByName(column), target);
+    }
+
     template <typename T>
     Nullable<T> getNullable(int pos) const
     {
@@ -80,15 +109,67 @@ public:
     }
 
 private:
+    // Extractors without range check, for TypedRowIterator which checks the
+    // column count once per execution.
+    template <typename T, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
+    void getUnchecked(int pos, T &target) const
+    {
+        #ifdef _MSC_VER
+            #pragma warning(suppress: 4800)
+        #endif
+        target = static_cast<T>(NativeExtractor::extractLongLong(m_stmt, pos));
+    }
+
+    template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+    void getUnchecked(int pos, T &target) const
+    {
+        target = static_cast<T>(NativeExtractor::extractDouble(m_stmt, pos));
+    }
+
+    template <typename T,
+              typename std::enable_if<
+                  !(std::is_integral<T>::value || std::is_floating_point<T>::value)
+                  >::type* = nullptr>
+    void getUnchecked(int pos, T &target) const
+    {
+        IntoExtractor<T>::extractInto(m_stmt, pos, target);
+        attachGuard(target);
+    }
+
+    template <typename T>
+    void getUnchecked(int pos, Nullable<T> &target) const
+    {
+        if (isNull(pos))
+        {
+            target.setNull();
+            return;
+        }
+        T value;
+        getUnchecked(pos, value);
+        target.setValue(value);
+    }
+
+    template <typename T>
+    void attachGuard(T &) const
+    {
+    }
+
+    // views point into the current row, attach a guard for debug builds
+    void attachGuard(StringView &view) const;
+    void attachGuard(BlobView &view) const;
+
     void setColumns(int columns);
     void checkPosRange(int pos) const;
     int getPosByName(const char *column) const;
 
     sqlite3_stmt *m_stmt = nullptr;
+    StatementMetadata *m_metadata = nullptr;
     int m_columns = 0;
-    mutable std::map<std::string, int> m_columnNames;
 
+    friend class Connection;
     friend class RowIterator;
+    friend class Statement;
+    template <typename T> friend class TypedRowIterator;
 };
 
 class RowIterator : public std::iterator<std::input_iterator_tag, Row, void>
@@ -97,6 +178,7 @@ public:
     enum struct Done {False, True};
 
     RowIterator(sqlite3 *conn, sqlite3_stmt *stmt, Done done);
+    RowIterator(sqlite3 *conn, sqlite3_stmt *stmt, Done done, StatementMetadata *metadata);
     bool operator==(const RowIterator &rhs) const;
     bool operator!=(const RowIterator &rhs) const;
     RowIterator &operator++();
@@ -107,6 +189,7 @@ private:
     sqlite3 *m_conn;
     sqlite3_stmt *m_stmt;
     bool m_done;
+    bool m_columnsKnown = false;
     Row m_row;
 };
 
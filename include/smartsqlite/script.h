@@ -0,0 +1,53 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "row.h"
+
+struct sqlite3;
+
+namespace SmartSqlite {
+
+using RowCallback = std::function<void(const Row &row)>;
+
+/**
+ * @brief A sequence of SQL statements that is compiled once and run many times.
+ *
+ * Statements are compiled lazily, each one right before it is run for the
+ * first time. This way, later statements can refer to tables that are created
+ * by earlier statements of the same script. Subsequent runs only reset the
+ * compiled statements.
+ */
+class Script
+{
+public:
+    Script(sqlite3 *conn, const std::string &sql);
+    // a moved-from Script may only be destroyed or assigned to
+    Script(Script &&other);
+    Script &operator=(Script &&rhs);
+    ~Script();
+
+    void exec();
+    // callback is invoked for every row returned by any of the statements
+    void exec(const RowCallback &callback);
+
+    /// The number of statements that have been compiled so far
+    std::size_t compiledStatements() const;
+
+private:
+    bool compileNext();
+
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+}
@@ -6,20 +6,58 @@
  */
 #pragma once
 
+#include <cstdint>
+#include <iterator>
 #include <memory>
+#include <string>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "binder.h"
+#include "columnbatch.h"
+#include "fields.h"
 #include "nullable.h"
+#include "resultset.h"
 #include "row.h"
+#include "typedrows.h"
 #include "util.h"
 
 namespace SmartSqlite {
 
+class StatementCache;
+struct StatementMetadata;
+
+// A parameter position resolved once by Statement::parameter()
+class Param
+{
+public:
+    explicit Param(int pos)
+        : m_pos(pos)
+    {
+    }
+
+    int pos() const
+    {
+        return m_pos;
+    }
+
+private:
+    int m_pos;
+};
+
 class Statement
 {
 public:
     explicit Statement(sqlite3 *conn, sqlite3_stmt *stmt);
+    // on destruction, stmt is handed back to cache instead of being finalized
+    explicit Statement(
+            sqlite3 *conn,
+            sqlite3_stmt *stmt,
+            std::shared_ptr<StatementCache> cache,
+            std::shared_ptr<StatementMetadata> metadata = nullptr);
+    // a moved-from Statement may only be destroyed or assigned to
     Statement(Statement &&other);
     Statement &operator=(Statement &&rhs);
     ~Statement();
@@ -28,7 +66,7 @@ public:
     template <typename T, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
     Statement &bind(int pos, const T& value)
     {
-        CHECK_RESULT(NativeBinder::bindLongLong(statementHandle(), pos, static_cast<long long>(value)));
+        CHECK_RESULT(bindValue(pos, value));
         return *this;
     }
 
@@ -36,15 +74,16 @@ public:
     template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
     Statement &bind(int pos, const T& value)
     {
-        CHECK_RESULT(NativeBinder::bindDouble(statementHandle(), pos, static_cast<double>(value)));
+        CHECK_RESULT(bindValue(pos, value));
         return *this;
     }
 
-    // handle all other types by specializations of the Binder template
+    // handle all other types by specializations of the Binder template;
+    // arrays decay to pointers, so string literals use Binder<const char *>
     template <typename T, typename std::enable_if<!(std::is_integral<T>::value || std::is_floating_point<T>::value)>::type* = nullptr>
     Statement &bind(int pos, const T& values)
     {
-        CHECK_RESULT(Binder<T>::bind(statementHandle(), pos, values));
+        CHECK_RESULT(bindValue(pos, values));
         return *this;
     }
 
@@ -70,12 +109,237 @@ public:
         return bind(getParameterPos(name), values);
     }
 
+    /**
+     * @brief Resolves a parameter name to a position.
+     *
+     * Binding by name looks up the name in an index that is built once per
+     * prepared statement. In tight loops, resolve the name once using this
+     * method and bind via the returned handle.
+     */
+    Param parameter(const char *name);
+
+    template <typename T>
+    Statement &bind(Param param, T &&value)
+    {
+        return bind(param.pos(), std::forward<T>(value));
+    }
+
+    // Borrowing binders: value is not copied. The caller guarantees that the
+    // referenced data stays valid and unchanged until the parameter is bound
+    // again or clearBindings() is called; reset() keeps the bindings, so it
+    // doesn't end the borrow. When SMARTSQLITE_CHECK_BORROWED_BINDINGS is enabled
+    // (default for builds without NDEBUG), modifications are detected when
+    // the statement is executed or reset, and BorrowedBindingModified is thrown.
+    Statement &bind(int pos, const StringView &value);
+    Statement &bind(int pos, const BlobView &value);
+    // array parameters for carray(), see Binder<std::vector<std::int64_t>>
+    Statement &bind(int pos, const std::vector<std::int64_t> &values);
+    Statement &bind(int pos, const std::vector<double> &values);
+    Statement &bind(int pos, const std::vector<std::string> &values);
+
+    // Owning binders: value is moved into the statement instead of being
+    // copied by SQLite. It is released when the parameter is bound again,
+    // when the bindings are cleared or when the statement is destroyed.
+    Statement &bind(int pos, std::string &&value);
+    Statement &bind(int pos, std::vector<unsigned char> &&value);
+    Statement &bind(const char *name, std::string &&value);
+    Statement &bind(const char *name, std::vector<unsigned char> &&value);
+
+    // array parameters for carray(), moved into the binding
+    Statement &bind(int pos, std::vector<std::int64_t> &&values);
+    Statement &bind(int pos, std::vector<double> &&values);
+    Statement &bind(int pos, std::vector<std::string> &&values);
+
     Statement &bindRawBlob(int pos, void *value, std::size_t size);
     Statement &bindRawBlob(const char *name, void *value, std::size_t size);
 
     Statement &bindNull(int pos);
     Statement &bindNull(const char *parameter);
 
+    /**
+     * @brief Binds all parameters in one pass, starting at position 0.
+     *
+     * Throws ParameterCountMismatch if the number of arguments doesn't match
+     * the number of parameters of the statement. Bind results are checked
+     * once for the whole pack.
+     */
+    template <typename... Args>
+    Statement &bindAll(Args&&... args)
+    {
+        checkParameterCount(sizeof...(Args));
+        CHECK_RESULT(bindValues(0, std::forward<Args>(args)...));
+        return *this;
+    }
+
+    /**
+     * @brief Runs the statement with the current bindings and resets it.
+     *
+     * Returns the number of rows changed, which is 0 for statements other
+     * than INSERT, UPDATE and DELETE. Throws QueryReturnedRows if the
+     * statement returns rows.
+     */
+    int execute();
+
+    // bindAll(args...) followed by execute()
+    template <typename Arg, typename... Args>
+    int execute(Arg &&arg, Args&&... args)
+    {
+        bindAll(std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return execute();
+    }
+
+    /**
+     * @brief Runs the statement once for every element of rows.
+     *
+     * Elements can be tuples, pairs or structs for which Fields is
+     * specialized. If rowsPerTransaction is not 0 and no transaction is
+     * active, every chunk of rowsPerTransaction rows is wrapped in a
+     * transaction. On failure, the current chunk is rolled back while
+     * previous chunks stay committed. Returns the total number of rows changed.
+     */
+    template <typename Range>
+    std::int64_t executeMany(const Range &rows, std::size_t rowsPerTransaction = 0)
+    {
+        using Element = typename std::decay<decltype(*std::begin(rows))>::type;
+        using Tuple = typename std::decay<decltype(Fields<Element>::tie(std::declval<const Element &>()))>::type;
+        using Indices = typename Detail::MakeIndexSequence<std::tuple_size<Tuple>::value>::type;
+
+        checkParameterCount(std::tuple_size<Tuple>::value);
+
+        std::int64_t changes = 0;
+        std::size_t rowsInChunk = 0;
+        bool inTransaction = false;
+        try
+        {
+            for (const auto &row : rows)
+            {
+                if (rowsPerTransaction && rowsInChunk == 0)
+                {
+                    inTransaction = beginImplicitTransaction();
+                }
+
+                CHECK_RESULT(bindTuple(Fields<Element>::tie(row), Indices()));
+                changes += executeRow();
+
+                if (rowsPerTransaction && ++rowsInChunk == rowsPerTransaction)
+                {
+                    if (inTransaction) commitImplicitTransaction();
+                    inTransaction = false;
+                    rowsInChunk = 0;
+                }
+            }
+            if (inTransaction) commitImplicitTransaction();
+        }
+        catch (...)
+        {
+            if (inTransaction) rollbackImplicitTransaction();
+            throw;
+        }
+        return changes;
+    }
+
+    /*
+     * Non-throwing API for hot paths: these methods return SQLite result
+     * codes instead of throwing, and don't build error messages. Use
+     * errorMessage() to get the message of the last error. Only the debug
+     * check for modified borrowed bindings may still throw.
+     *
+     * Connections enable extended result codes, so errors of tryStep(),
+     * tryExecute() and tryReset() are extended codes such as
+     * SQLITE_BUSY_SNAPSHOT or SQLITE_CONSTRAINT_UNIQUE. Compare
+     * (result & 0xff) against primary codes like SQLITE_BUSY.
+     */
+
+    // returns SQLITE_OK or the error of the binder
+    template <typename T>
+    int tryBind(int pos, T &&value)
+    {
+        return bindValue(pos, std::forward<T>(value));
+    }
+
+    int tryBindNull(int pos)
+    {
+        return bindNullValue(pos);
+    }
+
+    /**
+     * @brief Steps through the results.
+     *
+     * Returns SQLITE_ROW if a result row is available through row(),
+     * SQLITE_DONE at the end of the results or an extended error code. Call
+     * tryReset() before running the statement again.
+     */
+    int tryStep();
+
+    // The current row after tryStep() returned SQLITE_ROW
+    Row row();
+
+    /**
+     * @brief Runs the statement and resets it.
+     *
+     * Returns SQLITE_OK on success, SQLITE_ROW if the statement returned rows
+     * or the extended error code of the failed step.
+     */
+    int tryExecute();
+
+    // returns SQLITE_OK or the extended error code of the last step
+    int tryReset();
+
+    // message of the last error on the connection, owned by SQLite
+    const char *errorMessage() const;
+
+    // true if the statement doesn't write to the database
+    bool isReadOnly() const;
+
+    // Result column metadata, computed once per prepared statement
+    int columnCount();
+    const std::string &columnName(int pos);
+    // declared type of a table column, empty for expressions
+    const std::string &columnDeclaredType(int pos);
+
+    /**
+     * @brief Executes the statement and maps every result row to a tuple.
+     *
+     *     for (const auto &row : stmt.rows<std::int64_t, std::string>()) ...
+     *
+     * Throws ColumnCountMismatch (and resets the statement) if the number of
+     * result columns is not sizeof...(Columns). The tuple is reused for all
+     * rows, so copy it if it has to outlive the iteration step.
+     */
+    template <typename... Columns>
+    TypedRows<std::tuple<Columns...>> rows()
+    {
+        return rowsAs<std::tuple<Columns...>>();
+    }
+
+    // like rows(), for structs that specialize Fields
+    template <typename T>
+    TypedRows<T> rowsAs()
+    {
+        auto first = begin();
+        checkColumnCount(Detail::FieldCount<T>::value);
+        return TypedRows<T>(first, end());
+    }
+
+    /**
+     * @brief Fetches the next batchSize result rows into column buffers.
+     *
+     * The first call executes the statement. Following calls continue where
+     * the previous one stopped, until a batch with less than batchSize rows
+     * signals the end of the results. The overload taking a batch reuses its
+     * buffers and returns the number of rows fetched.
+     */
+    ColumnBatch fetchColumns(std::size_t batchSize);
+    std::size_t fetchColumns(ColumnBatch &batch, std::size_t batchSize);
+
+    /**
+     * @brief Executes the statement and copies all results into a ResultSet.
+     *
+     * The statement is reset afterwards, the results stay valid independent
+     * of the statement.
+     */
+    ResultSet fetchAll();
+
     bool hasResults();
     RowIterator begin();
     RowIterator end();
@@ -88,6 +352,77 @@ public:
 private:
     sqlite3_stmt *statementHandle() const;
     int getParameterPos(const char *name);
+    void checkParameterCount(std::size_t count) const;
+    void checkColumnCount(std::size_t count);
+
+    // helpers for executeMany()
+    int executeRow();
+    bool beginImplicitTransaction();
+    void commitImplicitTransaction();
+    void rollbackImplicitTransaction();
+
+    // Non-throwing binders, returning SQLite result codes
+
+    // Passes result through. If it is SQLITE_OK, pos has been bound to a value
+    // that the statement doesn't borrow or own, so the data of the previous
+    // binding isn't used anymore.
+    int boundCopy(int pos, int result);
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
+    int bindValue(int pos, const T& value)
+    {
+        return boundCopy(pos, NativeBinder::bindLongLong(statementHandle(), pos, static_cast<long long>(value)));
+    }
+
+    template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+    int bindValue(int pos, const T& value)
+    {
+        return boundCopy(pos, NativeBinder::bindDouble(statementHandle(), pos, static_cast<double>(value)));
+    }
+
+    template <typename T, typename std::enable_if<!(std::is_integral<T>::value || std::is_floating_point<T>::value)>::type* = nullptr>
+    int bindValue(int pos, const T& value)
+    {
+        return boundCopy(pos, Binder<typename std::decay<const T>::type>::bind(statementHandle(), pos, value));
+    }
+
+    template <typename T>
+    int bindValue(int pos, const Nullable<T> &value)
+    {
+        if (!value) return bindNullValue(pos);
+        return bindValue(pos, *value);
+    }
+
+    int bindValue(int pos, const StringView &value);
+    int bindValue(int pos, const BlobView &value);
+    int bindValue(int pos, const std::vector<std::int64_t> &values);
+    int bindValue(int pos, const std::vector<double> &values);
+    int bindValue(int pos, const std::vector<std::string> &values);
+    int bindValue(int pos, std::string &&value);
+    int bindValue(int pos, std::vector<unsigned char> &&value);
+    int bindValue(int pos, std::vector<std::int64_t> &&values);
+    int bindValue(int pos, std::vector<double> &&values);
+    int bindValue(int pos, std::vector<std::string> &&values);
+    int bindNullValue(int pos);
+
+    int bindValues(int)
+    {
+        return 0;  // SQLITE_OK
+    }
+
+    template <typename Arg, typename... Args>
+    int bindValues(int pos, Arg &&arg, Args&&... args)
+    {
+        int result = bindValue(pos, std::forward<Arg>(arg));
+        if (result != 0) return result;
+        return bindValues(pos + 1, std::forward<Args>(args)...);
+    }
+
+    template <typename Tuple, std::size_t... I>
+    int bindTuple(const Tuple &values, Detail::IndexSequence<I...>)
+    {
+        return bindValues(0, std::get<I>(values)...);
+    }
 
     struct Impl;
     std::unique_ptr<Impl> impl;
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct sqlite3_stmt;
+
+namespace SmartSqlite {
+
+struct StatementMetadata;
+
+struct StatementCacheStats
+{
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::size_t size = 0;
+    std::size_t capacity = 0;
+};
+
+/**
+ * @brief LRU pool of idle prepared statements belonging to one Connection.
+ *
+ * Statements handed out by Connection::prepareCached() keep a reference to the
+ * cache. When they are destroyed, they are reset, their bindings are cleared
+ * and they are put back into the pool instead of being finalized. If the pool
+ * grows beyond its capacity, the least recently used statement is finalized.
+ */
+class StatementCache
+{
+public:
+    explicit StatementCache(std::size_t capacity);
+    ~StatementCache();
+
+    /// Takes an idle statement for sql out of the pool; nullptr on a miss.
+    /// On a hit, metadata is set to the metadata stored with the statement.
+    sqlite3_stmt *acquire(
+            const std::string &sql,
+            std::shared_ptr<StatementMetadata> &metadata);
+
+    /// Resets stmt and puts it back into the pool, together with its metadata.
+    /// Accepts nullptr.
+    void release(sqlite3_stmt *stmt, std::shared_ptr<StatementMetadata> metadata);
+
+    void setCapacity(std::size_t capacity);
+    StatementCacheStats stats() const;
+
+    /// Finalizes all idle statements.
+    void clear();
+
+    /// Clears the pool and finalizes all statements released from now on.
+    void close();
+
+private:
+    // StatementCache is not copyable
+    StatementCache(const StatementCache &) = delete;
+    StatementCache &operator=(const StatementCache &) = delete;
+
+    struct Entry
+    {
+        std::string sql;
+        sqlite3_stmt *stmt;
+        std::shared_ptr<StatementMetadata> metadata;
+    };
+    using EntryList = std::list<Entry>;
+
+    void evictOverCapacity();
+
+    mutable std::mutex mutex_;
+    std::size_t capacity_;
+    bool closed_ = false;
+    StatementCacheStats stats_;
+
+    // most recently used entries are at the front
+    EntryList lru_;
+    std::unordered_map<std::string, EntryList::iterator> index_;
+};
+
+}
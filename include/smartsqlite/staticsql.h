@@ -0,0 +1,167 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include "statement.h"
+
+namespace SmartSqlite {
+
+namespace Detail {
+
+// Lexer states while scanning SQL text for parameters
+enum ScanState { InSql = 0, InSingleQuotes = 1, InDoubleQuotes = 2 };
+
+// Result of scanning a range of SQL text, for every possible start state
+struct ParameterScan
+{
+    int endState[3];
+    int count[3];
+    bool unsupported[3];
+};
+
+constexpr bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+constexpr int nextState(int state, char c)
+{
+    return state == InSql
+            ? (c == '\'' ? InSingleQuotes : c == '"' ? InDoubleQuotes : InSql)
+            : state == InSingleQuotes
+              ? (c == '\'' ? InSql : InSingleQuotes)
+              : (c == '"' ? InSql : InDoubleQuotes);
+}
+
+constexpr bool isUnsupportedParameter(const char *sql, std::size_t i)
+{
+    return sql[i] == ':' || sql[i] == '@' || sql[i] == '$' ||
+            (sql[i] == '?' && isDigit(sql[i + 1]));
+}
+
+constexpr ParameterScan scanChar(const char *sql, std::size_t i)
+{
+    return ParameterScan{
+        {nextState(InSql, sql[i]),
+         nextState(InSingleQuotes, sql[i]),
+         nextState(InDoubleQuotes, sql[i])},
+        {sql[i] == '?' ? 1 : 0, 0, 0},
+        {isUnsupportedParameter(sql, i), false, false}};
+}
+
+constexpr ParameterScan combine(const ParameterScan &left, const ParameterScan &right)
+{
+    return ParameterScan{
+        {right.endState[left.endState[0]],
+         right.endState[left.endState[1]],
+         right.endState[left.endState[2]]},
+        {left.count[0] + right.count[left.endState[0]],
+         left.count[1] + right.count[left.endState[1]],
+         left.count[2] + right.count[left.endState[2]]},
+        {left.unsupported[0] || right.unsupported[left.endState[0]],
+         left.unsupported[1] || right.unsupported[left.endState[1]],
+         left.unsupported[2] || right.unsupported[left.endState[2]]}};
+}
+
+// Divide and conquer keeps the recursion depth logarithmic, so that long
+// statements don't hit the compiler's constexpr depth limit.
+constexpr ParameterScan scan(const char *sql, std::size_t begin, std::size_t end)
+{
+    return end - begin == 0
+            ? ParameterScan{{InSql, InSingleQuotes, InDoubleQuotes}, {0, 0, 0}, {false, false, false}}
+            : end - begin == 1
+              ? scanChar(sql, begin)
+              : combine(scan(sql, begin, begin + (end - begin) / 2),
+                        scan(sql, begin + (end - begin) / 2, end));
+}
+
+constexpr int parameterCount(const ParameterScan &result)
+{
+    return (result.unsupported[InSql] || result.endState[InSql] != InSql)
+            ? -1
+            : result.count[InSql];
+}
+
+}
+
+/**
+ * @brief Counts the parameters of a SQL string literal at compile time.
+ *
+ * Only anonymous "?" parameters are supported. Returns -1 for SQL containing
+ * named or numbered parameters or unterminated quotes. Comments are not
+ * recognized, so they must not contain question marks or quotes.
+ */
+template <std::size_t N>
+constexpr int countParameters(const char (&sql)[N])
+{
+    return Detail::parameterCount(Detail::scan(sql, 0, N - 1));
+}
+
+/// SQL text whose number of parameters is known at compile time
+template <int ParameterCount>
+class StaticSql
+{
+    static_assert(ParameterCount >= 0,
+                  "Parameters can only be counted at compile time for SQL "
+                  "with anonymous parameters (?) only");
+
+public:
+    explicit StaticSql(const char *text)
+        : m_text(text)
+    {
+    }
+
+    const char *text() const
+    {
+        return m_text;
+    }
+
+private:
+    const char *m_text;
+};
+
+/**
+ * @brief A statement whose number of parameters is checked at compile time.
+ *
+ * Created by Connection::prepare() from SMARTSQLITE_SQL("...").
+ */
+template <int ParameterCount>
+class CheckedStatement : public Statement
+{
+public:
+    explicit CheckedStatement(Statement &&stmt)
+        : Statement(std::move(stmt))
+    {
+    }
+
+    template <typename... Args>
+    CheckedStatement &bindAll(Args&&... args)
+    {
+        static_assert(sizeof...(Args) == ParameterCount,
+                      "Number of arguments doesn't match the number of parameters");
+        Statement::bindAll(std::forward<Args>(args)...);
+        return *this;
+    }
+
+    using Statement::execute;
+
+    template <typename Arg, typename... Args>
+    int execute(Arg &&arg, Args&&... args)
+    {
+        bindAll(std::forward<Arg>(arg), std::forward<Args>(args)...);
+        return Statement::execute();
+    }
+};
+
+}
+
+/// Wraps a SQL string literal so that its parameters are counted at compile time
+#define SMARTSQLITE_SQL(literal) \
+    SmartSqlite::StaticSql<SmartSqlite::countParameters(literal)>(literal)
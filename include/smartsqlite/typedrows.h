@@ -0,0 +1,121 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "fields.h"
+#include "row.h"
+
+namespace SmartSqlite {
+
+namespace Detail {
+
+// number of result columns that are mapped to T
+template <typename T>
+struct FieldCount
+{
+    using Tuple = typename std::decay<decltype(Fields<T>::tie(std::declval<T &>()))>::type;
+    static constexpr std::size_t value = std::tuple_size<Tuple>::value;
+};
+
+}
+
+/**
+ * @brief Iterates over the results of a statement, mapping each row to T.
+ *
+ * The column count is checked once by Statement::rowsAs(). The columns are
+ * then extracted without range checks into a value that is reused for all
+ * rows, so strings and blobs keep their capacity.
+ */
+template <typename T>
+class TypedRowIterator : public std::iterator<std::input_iterator_tag, T, void>
+{
+public:
+    explicit TypedRowIterator(RowIterator iter)
+        : m_iter(std::move(iter))
+    {
+    }
+
+    bool operator==(const TypedRowIterator &rhs) const
+    {
+        return m_iter == rhs.m_iter;
+    }
+
+    bool operator!=(const TypedRowIterator &rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    TypedRowIterator &operator++()
+    {
+        ++m_iter;
+        m_extracted = false;
+        return *this;
+    }
+
+    const T &operator*()
+    {
+        if (!m_extracted)
+        {
+            extract(Fields<T>::tie(m_value), Indices());
+            m_extracted = true;
+        }
+        return m_value;
+    }
+
+    const T *operator->()
+    {
+        return &**this;
+    }
+
+private:
+    using Indices = typename Detail::MakeIndexSequence<Detail::FieldCount<T>::value>::type;
+
+    template <typename Tuple, std::size_t... I>
+    void extract(Tuple &&fields, Detail::IndexSequence<I...>)
+    {
+        const Row &row = *m_iter;
+        int expand[] = {0, (row.getUnchecked(static_cast<int>(I), std::get<I>(fields)), 0)...};
+        (void)expand;
+    }
+
+    RowIterator m_iter;
+    T m_value;
+    bool m_extracted = false;
+};
+
+// range returned by Statement::rows() and Statement::rowsAs()
+template <typename T>
+class TypedRows
+{
+public:
+    TypedRows(RowIterator begin, RowIterator end)
+        : m_begin(std::move(begin)), m_end(std::move(end))
+    {
+    }
+
+    TypedRowIterator<T> begin() const
+    {
+        return m_begin;
+    }
+
+    TypedRowIterator<T> end() const
+    {
+        return m_end;
+    }
+
+private:
+    TypedRowIterator<T> m_begin;
+    TypedRowIterator<T> m_end;
+};
+
+}
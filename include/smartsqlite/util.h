@@ -29,8 +29,9 @@ struct sqlite3_stmt;
 
 namespace SmartSqlite {
 
-void checkResult(const std::string &func, int result);
-void checkResult(const std::string &func, int result, sqlite3 *conn, sqlite3_stmt *stmt = nullptr);
-void checkResult(const std::string &func, int result, const std::string &message);
+// func is a C string so that the success path doesn't allocate
+void checkResult(const char *func, int result);
+void checkResult(const char *func, int result, sqlite3 *conn, sqlite3_stmt *stmt = nullptr);
+void checkResult(const char *func, int result, const std::string &message);
 
 }
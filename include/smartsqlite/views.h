@@ -0,0 +1,183 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace SmartSqlite {
+
+/**
+ * @brief Detects views that are used after the data they refer to is gone.
+ *
+ * Views extracted from a Row refer to SQLite's memory, which is only valid
+ * until the statement is stepped, reset or destroyed. If the library is
+ * built with SMARTSQLITE_CHECK_VIEWS (default for builds without NDEBUG),
+ * such views carry a guard, and accessing their data afterwards triggers an
+ * assertion.
+ */
+class ViewGuard
+{
+public:
+    ViewGuard()
+    {
+    }
+
+    explicit ViewGuard(std::shared_ptr<const std::uint64_t> generation)
+        : m_generation(std::move(generation)), m_expected(*m_generation)
+    {
+    }
+
+    bool isValid() const
+    {
+        return !m_generation || *m_generation == m_expected;
+    }
+
+private:
+    std::shared_ptr<const std::uint64_t> m_generation;
+    std::uint64_t m_expected = 0;
+};
+
+/**
+ * @brief Non-owning reference to a sequence of characters.
+ *
+ * The referenced data is not required to be null-terminated.
+ */
+class StringView
+{
+public:
+    StringView()
+    {
+    }
+
+    StringView(const char *data, std::size_t size)
+        : m_data(data), m_size(size)
+    {
+    }
+
+    StringView(const char *str)
+        : m_data(str), m_size(str ? std::strlen(str) : 0)
+    {
+    }
+
+    StringView(const std::string &str)
+        : m_data(str.data()), m_size(str.size())
+    {
+    }
+
+    const char *data() const
+    {
+        assert(m_guard.isValid() && "StringView used after its row was left");
+        return m_data;
+    }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const char *begin() const { return data(); }
+    const char *end() const { return data() + m_size; }
+
+    std::string toString() const
+    {
+        return std::string(data(), m_size);
+    }
+
+    bool operator==(const StringView &rhs) const
+    {
+        return m_size == rhs.m_size &&
+                (m_size == 0 || std::memcmp(data(), rhs.data(), m_size) == 0);
+    }
+
+    bool operator!=(const StringView &rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    void setGuard(ViewGuard guard)
+    {
+        m_guard = std::move(guard);
+    }
+
+    // false if the data this view refers to is known to be gone
+    bool isValid() const
+    {
+        return m_guard.isValid();
+    }
+
+private:
+    const char *m_data = nullptr;
+    std::size_t m_size = 0;
+    ViewGuard m_guard;
+};
+
+/**
+ * @brief Non-owning reference to a sequence of bytes.
+ */
+class BlobView
+{
+public:
+    BlobView()
+    {
+    }
+
+    BlobView(const void *data, std::size_t size)
+        : m_data(static_cast<const unsigned char*>(data)), m_size(size)
+    {
+    }
+
+    BlobView(const std::vector<unsigned char> &blob)
+        : m_data(blob.data()), m_size(blob.size())
+    {
+    }
+
+    const unsigned char *data() const
+    {
+        assert(m_guard.isValid() && "BlobView used after its row was left");
+        return m_data;
+    }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    const unsigned char *begin() const { return data(); }
+    const unsigned char *end() const { return data() + m_size; }
+
+    std::vector<unsigned char> toVector() const
+    {
+        return std::vector<unsigned char>(begin(), end());
+    }
+
+    bool operator==(const BlobView &rhs) const
+    {
+        return m_size == rhs.m_size &&
+                (m_size == 0 || std::memcmp(data(), rhs.data(), m_size) == 0);
+    }
+
+    bool operator!=(const BlobView &rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+    void setGuard(ViewGuard guard)
+    {
+        m_guard = std::move(guard);
+    }
+
+    // false if the data this view refers to is known to be gone
+    bool isValid() const
+    {
+        return m_guard.isValid();
+    }
+
+private:
+    const unsigned char *m_data = nullptr;
+    std::size_t m_size = 0;
+    ViewGuard m_guard;
+};
+
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "connection.h"
+
+namespace SmartSqlite {
+
+struct WriteQueueOptions
+{
+    // maximum number of writes committed in one transaction
+    std::size_t maxBatchSize = 256;
+
+    // How long the writer waits for more writes after the first write of a
+    // batch has arrived. Zero only batches writes that are already queued.
+    std::chrono::microseconds maxLatency = std::chrono::milliseconds(1);
+
+    // called on the writer thread after the connection has been opened,
+    // e.g. to set the journal mode or a busy timeout
+    std::function<void(Connection &)> setup;
+};
+
+struct WriteQueueStats
+{
+    std::uint64_t batches = 0;
+    std::uint64_t writes = 0;
+    std::uint64_t failedWrites = 0;
+    std::size_t largestBatch = 0;
+};
+
+/**
+ * @brief Coalesces writes from many threads into few transactions.
+ *
+ * Writes can be submitted from any thread. A single writer thread with its
+ * own connection commits them in batches, each in one BEGIN IMMEDIATE ...
+ * COMMIT, so a batch costs one sync instead of one per write.
+ *
+ * Every write runs inside its own savepoint. If it throws, only its changes
+ * are rolled back and only its future receives the exception. If SQLite
+ * rolls back the whole transaction instead, e.g. for ON CONFLICT ROLLBACK,
+ * the earlier writes of the batch fail as well and the remaining ones run in
+ * a new transaction. Futures are fulfilled after the batch has been
+ * committed; if the commit fails, the writes that haven't failed yet fail
+ * with the commit's exception.
+ */
+class WriteQueue
+{
+public:
+    // throws if the connection can't be opened or setup throws
+    explicit WriteQueue(
+            const std::string &connectionString,
+            WriteQueueOptions options = WriteQueueOptions());
+    // commits all queued writes
+    ~WriteQueue();
+
+    /**
+     * @brief Runs work(Connection &) as part of the next batch.
+     *
+     * work must not begin or end transactions itself, and objects obtained
+     * from the connection must not escape it.
+     */
+    template <typename Work>
+    auto submit(Work work) -> std::future<decltype(work(std::declval<Connection &>()))>
+    {
+        using Result = decltype(work(std::declval<Connection &>()));
+        std::unique_ptr<TypedWrite<Result>> write(
+                    new TypedWrite<Result>(std::move(work)));
+        auto future = write->promise.get_future();
+        enqueue(std::move(write));
+        return future;
+    }
+
+    // prepares sql (cached), executes it with args and returns changes()
+    template <typename... Args>
+    std::future<int> execute(std::string sql, Args... args)
+    {
+        return submit([sql, args...](Connection &conn) {
+            return conn.prepareCached(sql).execute(args...);
+        });
+    }
+
+    WriteQueueStats stats() const;
+
+private:
+    // WriteQueue is neither copyable nor movable
+    WriteQueue(const WriteQueue &) = delete;
+    WriteQueue &operator=(const WriteQueue &) = delete;
+
+    class Write
+    {
+    public:
+        virtual ~Write() = default;
+        virtual void run(Connection &conn) = 0;
+        // called after the batch has been committed
+        virtual void succeed() = 0;
+        virtual void fail(std::exception_ptr exception) = 0;
+    };
+
+    template <typename Result>
+    class TypedWrite : public Write
+    {
+    public:
+        template <typename Work>
+        explicit TypedWrite(Work fn) : work(std::move(fn)) {}
+
+        void run(Connection &conn) override
+        {
+            result.reset(new Result(work(conn)));
+        }
+
+        void succeed() override
+        {
+            promise.set_value(std::move(*result));
+        }
+
+        void fail(std::exception_ptr exception) override
+        {
+            promise.set_exception(exception);
+        }
+
+        std::function<Result(Connection &)> work;
+        std::unique_ptr<Result> result;
+        std::promise<Result> promise;
+    };
+
+    void enqueue(std::unique_ptr<Write> write);
+
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+template <>
+class WriteQueue::TypedWrite<void> : public WriteQueue::Write
+{
+public:
+    template <typename Work>
+    explicit TypedWrite(Work fn) : work(std::move(fn)) {}
+
+    void run(Connection &conn) override
+    {
+        work(conn);
+    }
+
+    void succeed() override
+    {
+        promise.set_value();
+    }
+
+    void fail(std::exception_ptr exception) override
+    {
+        promise.set_exception(exception);
+    }
+
+    std::function<void(Connection &)> work;
+    std::promise<void> promise;
+};
+
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include "smartsqlite/asyncconnection.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace SmartSqlite {
+
+struct AsyncConnection::Impl
+{
+    using Work = std::function<void(Connection &)>;
+
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::deque<Work> queue;
+    bool stopping = false;
+    std::thread worker;
+
+    void run(const std::string &connectionString, std::promise<void> opened)
+    {
+        std::unique_ptr<Connection> conn;
+        try
+        {
+            conn.reset(new Connection(connectionString));
+        }
+        catch (...)
+        {
+            opened.set_exception(std::current_exception());
+            return;
+        }
+        opened.set_value();
+
+        std::deque<Work> batch;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;  // stopping and drained
+                batch.swap(queue);
+            }
+
+            // run everything that was queued without taking the lock again
+            for (auto &work : batch)
+            {
+                work(*conn);
+            }
+            batch.clear();
+        }
+    }
+};
+
+AsyncConnection::AsyncConnection(const std::string &connectionString)
+    : impl(new Impl)
+{
+    std::promise<void> opened;
+    auto openedFuture = opened.get_future();
+    impl->worker = std::thread(&Impl::run, impl.get(), connectionString, std::move(opened));
+
+    try
+    {
+        openedFuture.get();
+    }
+    catch (...)
+    {
+        impl->worker.join();
+        throw;
+    }
+}
+
+AsyncConnection::~AsyncConnection()
+{
+    {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        impl->stopping = true;
+    }
+    impl->wakeUp.notify_one();
+    impl->worker.join();
+}
+
+void AsyncConnection::post(std::function<void(Connection &)> work, CompletionCallback done)
+{
+    enqueue([work, done](Connection &conn) {
+        std::exception_ptr exception;
+        try
+        {
+            work(conn);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        if (done) done(exception);
+    });
+}
+
+std::future<void> AsyncConnection::exec(std::string sql)
+{
+    return submit([sql](Connection &conn) {
+        conn.exec(sql);
+    });
+}
+
+std::future<ResultSet> AsyncConnection::query(std::string sql)
+{
+    return submit([sql](Connection &conn) {
+        return conn.prepareCached(sql).fetchAll();
+    });
+}
+
+void AsyncConnection::enqueue(std::function<void(Connection &)> work)
+{
+    {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        impl->queue.push_back(std::move(work));
+    }
+    impl->wakeUp.notify_one();
+}
+
+void AsyncConnection::rollback(Connection &conn)
+{
+    try
+    {
+        conn.rollbackTransaction();
+    }
+    catch (...)
+    {
+        // SQLite may have rolled back already, e.g. after SQLITE_FULL;
+        // the original exception is more relevant
+    }
+}
+
+}
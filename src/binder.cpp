@@ -8,7 +8,9 @@
 
 #include <cassert>
 #include <limits>
+#include <memory>
 
+#include "carray.h"
 #include "smartsqlite/sqlite3.h"
 
 namespace SmartSqlite {
@@ -17,6 +19,23 @@ namespace {
 
 const char *EMPTY_CSTRING = "";
 
+int bindArray(sqlite3_stmt *stmt, int pos, std::unique_ptr<ArrayParameter> array)
+{
+    // SQLite calls the destructor even if binding fails
+    return sqlite3_bind_pointer(
+                stmt, pos + 1, array.release(), CARRAY_POINTER_TYPE,
+                deleteArrayParameter);
+}
+
+std::unique_ptr<ArrayParameter> makeArray(ArrayParameter::Type type, const void *data, size_t size)
+{
+    std::unique_ptr<ArrayParameter> array(new ArrayParameter);
+    array->type = type;
+    array->data = data;
+    array->size = size;
+    return array;
+}
+
 }
 
 int NativeBinder::bindLongLong(sqlite3_stmt *stmt, int pos, long long value)
@@ -41,6 +60,11 @@ int NativeBinder::bindString(sqlite3_stmt *stmt, int pos, const std::string &val
     return sqlite3_bind_text(stmt, pos + 1, data, sizeInt, SQLITE_TRANSIENT);
 }
 
+int NativeBinder::bindString(sqlite3_stmt *stmt, int pos, const char *value)
+{
+    return sqlite3_bind_text(stmt, pos + 1, value, -1, SQLITE_TRANSIENT);
+}
+
 int NativeBinder::bindBlob(sqlite3_stmt *stmt, int pos, const void *data, size_t size)
 {
     if (!data && !size) data = EMPTY_CSTRING;
@@ -51,4 +75,61 @@ int NativeBinder::bindBlob(sqlite3_stmt *stmt, int pos, const void *data, size_t
     return sqlite3_bind_blob(stmt, pos + 1, data, sizeInt, SQLITE_TRANSIENT);
 }
 
+int NativeBinder::bindStaticString(sqlite3_stmt *stmt, int pos, const char *data, size_t size)
+{
+    if (!data && !size) data = EMPTY_CSTRING;
+
+    return sqlite3_bind_text64(
+                stmt, pos + 1, data, static_cast<sqlite3_uint64>(size),
+                SQLITE_STATIC, SQLITE_UTF8);
+}
+
+int NativeBinder::bindStaticBlob(sqlite3_stmt *stmt, int pos, const void *data, size_t size)
+{
+    if (!data && !size) data = EMPTY_CSTRING;
+
+    return sqlite3_bind_blob64(
+                stmt, pos + 1, data, static_cast<sqlite3_uint64>(size),
+                SQLITE_STATIC);
+}
+
+int NativeBinder::bindInt64Array(sqlite3_stmt *stmt, int pos, const std::int64_t *data, size_t size)
+{
+    return bindArray(stmt, pos, makeArray(ArrayParameter::Int64, data, size));
+}
+
+int NativeBinder::bindDoubleArray(sqlite3_stmt *stmt, int pos, const double *data, size_t size)
+{
+    return bindArray(stmt, pos, makeArray(ArrayParameter::Double, data, size));
+}
+
+int NativeBinder::bindTextArray(sqlite3_stmt *stmt, int pos, const std::string *data, size_t size)
+{
+    return bindArray(stmt, pos, makeArray(ArrayParameter::Text, data, size));
+}
+
+int NativeBinder::bindInt64Array(sqlite3_stmt *stmt, int pos, std::vector<std::int64_t> &&values)
+{
+    auto array = makeArray(ArrayParameter::Int64, nullptr, values.size());
+    array->ownedInt64 = std::move(values);
+    array->data = array->ownedInt64.data();
+    return bindArray(stmt, pos, std::move(array));
+}
+
+int NativeBinder::bindDoubleArray(sqlite3_stmt *stmt, int pos, std::vector<double> &&values)
+{
+    auto array = makeArray(ArrayParameter::Double, nullptr, values.size());
+    array->ownedDouble = std::move(values);
+    array->data = array->ownedDouble.data();
+    return bindArray(stmt, pos, std::move(array));
+}
+
+int NativeBinder::bindTextArray(sqlite3_stmt *stmt, int pos, std::vector<std::string> &&values)
+{
+    auto array = makeArray(ArrayParameter::Text, nullptr, values.size());
+    array->ownedText = std::move(values);
+    array->data = array->ownedText.data();
+    return bindArray(stmt, pos, std::move(array));
+}
+
 }
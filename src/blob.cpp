@@ -31,9 +31,8 @@ Blob::Blob(sqlite3 *conn, sqlite3_blob *blob)
 }
 
 Blob::Blob(Blob &&other)
-    : impl(new Impl)
+    : impl(std::move(other.impl))
 {
-    std::swap(impl, other.impl);
 }
 
 Blob &Blob::operator=(Blob &&rhs)
@@ -44,6 +43,9 @@ Blob &Blob::operator=(Blob &&rhs)
 
 Blob::~Blob()
 {
+    // moved-from
+    if (!impl) return;
+
     sqlite3_blob_close(impl->blob);
 }
 
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include "carray.h"
+
+#include <cassert>
+#include <limits>
+#include <new>
+
+#include "smartsqlite/sqlite3.h"
+
+namespace SmartSqlite {
+
+const char *const CARRAY_POINTER_TYPE = "smartsqlite-carray";
+
+void deleteArrayParameter(void *parameter)
+{
+    delete static_cast<ArrayParameter*>(parameter);
+}
+
+namespace {
+
+const int COLUMN_VALUE = 0;
+const int COLUMN_POINTER = 1;
+
+struct Cursor
+{
+    sqlite3_vtab_cursor base;  // must be first
+    const ArrayParameter *array;
+    std::size_t index;
+};
+
+int carrayConnect(
+        sqlite3 *conn, void *, int, const char *const*,
+        sqlite3_vtab **vtab, char **)
+{
+    int result = sqlite3_declare_vtab(conn, "CREATE TABLE x(value, pointer HIDDEN)");
+    if (result != SQLITE_OK) return result;
+
+    *vtab = static_cast<sqlite3_vtab*>(sqlite3_malloc(sizeof(sqlite3_vtab)));
+    if (!*vtab) return SQLITE_NOMEM;
+    **vtab = sqlite3_vtab();
+    return SQLITE_OK;
+}
+
+int carrayDisconnect(sqlite3_vtab *vtab)
+{
+    sqlite3_free(vtab);
+    return SQLITE_OK;
+}
+
+int carrayBestIndex(sqlite3_vtab *, sqlite3_index_info *info)
+{
+    for (int i = 0; i < info->nConstraint; ++i)
+    {
+        const auto &constraint = info->aConstraint[i];
+        if (constraint.usable &&
+                constraint.iColumn == COLUMN_POINTER &&
+                constraint.op == SQLITE_INDEX_CONSTRAINT_EQ)
+        {
+            info->aConstraintUsage[i].argvIndex = 1;
+            info->aConstraintUsage[i].omit = 1;
+            info->idxNum = 1;
+            info->estimatedCost = 1;
+            info->estimatedRows = 100;
+            return SQLITE_OK;
+        }
+    }
+
+    // without an array, there are no rows
+    info->idxNum = 0;
+    info->estimatedCost = std::numeric_limits<double>::max();
+    info->estimatedRows = std::numeric_limits<sqlite3_int64>::max();
+    return SQLITE_OK;
+}
+
+int carrayOpen(sqlite3_vtab *, sqlite3_vtab_cursor **cursor)
+{
+    auto result = new (std::nothrow) Cursor();
+    if (!result) return SQLITE_NOMEM;
+    *cursor = &result->base;
+    return SQLITE_OK;
+}
+
+int carrayClose(sqlite3_vtab_cursor *cursor)
+{
+    delete reinterpret_cast<Cursor*>(cursor);
+    return SQLITE_OK;
+}
+
+int carrayFilter(
+        sqlite3_vtab_cursor *cursorBase, int idxNum, const char *,
+        int argc, sqlite3_value **argv)
+{
+    auto cursor = reinterpret_cast<Cursor*>(cursorBase);
+    cursor->index = 0;
+    cursor->array = nullptr;
+    if (idxNum == 1 && argc == 1)
+    {
+        cursor->array = static_cast<const ArrayParameter*>(
+                    sqlite3_value_pointer(argv[0], CARRAY_POINTER_TYPE));
+    }
+    return SQLITE_OK;
+}
+
+int carrayNext(sqlite3_vtab_cursor *cursor)
+{
+    ++reinterpret_cast<Cursor*>(cursor)->index;
+    return SQLITE_OK;
+}
+
+int carrayEof(sqlite3_vtab_cursor *cursorBase)
+{
+    auto cursor = reinterpret_cast<Cursor*>(cursorBase);
+    return !cursor->array || cursor->index >= cursor->array->size;
+}
+
+int carrayColumn(sqlite3_vtab_cursor *cursorBase, sqlite3_context *context, int column)
+{
+    auto cursor = reinterpret_cast<Cursor*>(cursorBase);
+    if (column != COLUMN_VALUE)
+    {
+        sqlite3_result_null(context);
+        return SQLITE_OK;
+    }
+
+    const auto &array = *cursor->array;
+    switch (array.type)
+    {
+    case ArrayParameter::Int64:
+        sqlite3_result_int64(
+                    context,
+                    static_cast<const std::int64_t*>(array.data)[cursor->index]);
+        break;
+    case ArrayParameter::Double:
+        sqlite3_result_double(
+                    context,
+                    static_cast<const double*>(array.data)[cursor->index]);
+        break;
+    case ArrayParameter::Text:
+    {
+        const auto &text = static_cast<const std::string*>(array.data)[cursor->index];
+        // the array outlives the cursor, so the text doesn't need to be copied
+        sqlite3_result_text64(
+                    context, text.data(), static_cast<sqlite3_uint64>(text.size()),
+                    SQLITE_STATIC, SQLITE_UTF8);
+        break;
+    }
+    default:
+        assert(false);
+    }
+    return SQLITE_OK;
+}
+
+int carrayRowid(sqlite3_vtab_cursor *cursor, sqlite3_int64 *rowid)
+{
+    *rowid = static_cast<sqlite3_int64>(reinterpret_cast<Cursor*>(cursor)->index) + 1;
+    return SQLITE_OK;
+}
+
+sqlite3_module makeCarrayModule()
+{
+    sqlite3_module module = sqlite3_module();
+    module.iVersion = 0;
+    // xCreate stays null: carray is an eponymous-only virtual table
+    module.xConnect = carrayConnect;
+    module.xBestIndex = carrayBestIndex;
+    module.xDisconnect = carrayDisconnect;
+    module.xOpen = carrayOpen;
+    module.xClose = carrayClose;
+    module.xFilter = carrayFilter;
+    module.xNext = carrayNext;
+    module.xEof = carrayEof;
+    module.xColumn = carrayColumn;
+    module.xRowid = carrayRowid;
+    return module;
+}
+
+const sqlite3_module CARRAY_MODULE = makeCarrayModule();
+
+}
+
+int registerCarray(sqlite3 *conn)
+{
+    return sqlite3_create_module(conn, "carray", &CARRAY_MODULE, nullptr);
+}
+
+}
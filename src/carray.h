@@ -0,0 +1,45 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+
+namespace SmartSqlite {
+
+// type tag for sqlite3_bind_pointer() / sqlite3_value_pointer()
+extern const char *const CARRAY_POINTER_TYPE;
+
+// Value of a parameter of the carray() table-valued function
+struct ArrayParameter
+{
+    enum Type { Int64, Double, Text };
+
+    Type type;
+    const void *data;
+    std::size_t size;
+
+    // storage for values that have been moved into the parameter
+    std::vector<std::int64_t> ownedInt64;
+    std::vector<double> ownedDouble;
+    std::vector<std::string> ownedText;
+};
+
+void deleteArrayParameter(void *parameter);
+
+/**
+ * Registers the eponymous virtual table carray(), which yields the values of
+ * an array parameter as a single column "value", e.g.
+ * SELECT * FROM foo WHERE id IN carray(?)
+ */
+int registerCarray(sqlite3 *conn);
+
+}
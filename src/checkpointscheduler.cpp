@@ -0,0 +1,223 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include "smartsqlite/checkpointscheduler.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "smartsqlite/exceptions.h"
+#include "smartsqlite/sqlite3.h"
+
+namespace SmartSqlite {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+// SQLite's default for wal_autocheckpoint
+const int DEFAULT_AUTOCHECKPOINT_FRAMES = 1000;
+}
+
+struct CheckpointScheduler::Impl
+{
+    CheckpointPolicy policy;
+    Connection conn;
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+    CheckpointStats stats;
+    // frames of the current WAL that are known to be checkpointed
+    int backfilledFrames = 0;
+    // commits since the last checkpoint
+    bool newCommits = false;
+    // no TRUNCATE checkpoint is due because there was no commit since the last one
+    bool idle = true;
+    Clock::time_point lastCommit;
+    // no RESTART checkpoints before this time
+    Clock::time_point restartBackoffUntil;
+    std::thread worker;
+
+    Impl(const std::string &filename, CheckpointPolicy policy)
+        : policy(policy), conn(filename)
+    {
+    }
+
+    static int walHook(void *arg, sqlite3 *, const char *, int walFrames)
+    {
+        auto self = static_cast<Impl *>(arg);
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(self->mutex);
+            // a writer has restarted the WAL from the beginning
+            if (walFrames < self->stats.walFrames) self->backfilledFrames = 0;
+            self->stats.walFrames = walFrames;
+            self->stats.maxWalFrames = std::max(self->stats.maxWalFrames, walFrames);
+            self->newCommits = true;
+            self->lastCommit = Clock::now();
+
+            // the worker sleeps without a timeout while idle
+            wake = self->idle
+                    || self->checkpointDue(self->lastCommit) != NoCheckpoint;
+            self->idle = false;
+        }
+        if (wake) self->wakeUp.notify_one();
+        return SQLITE_OK;
+    }
+
+    enum Due
+    {
+        NoCheckpoint,
+        DuePassive,
+        DueRestart,
+        DueTruncate
+    };
+
+    // must be called with mutex held
+    Due checkpointDue(Clock::time_point now) const
+    {
+        if (newCommits)
+        {
+            if (stats.walFrames >= policy.restartFrames && now >= restartBackoffUntil)
+            {
+                return DueRestart;
+            }
+            if (stats.walFrames - backfilledFrames >= policy.passiveFrames) return DuePassive;
+        }
+        if (!idle && now - lastCommit >= policy.idleTime) return DueTruncate;
+        return NoCheckpoint;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping)
+        {
+            auto due = checkpointDue(Clock::now());
+            if (due == NoCheckpoint)
+            {
+                if (idle) wakeUp.wait(lock);
+                else wakeUp.wait_until(lock, lastCommit + policy.idleTime);
+                continue;
+            }
+
+            newCommits = false;
+            if (due == DueTruncate) idle = true;
+
+            lock.unlock();
+            CheckpointMode mode = due == DuePassive ? CheckpointPassive
+                    : due == DueRestart ? CheckpointRestart
+                    : CheckpointTruncate;
+            CheckpointResult result;
+            bool failed = false;
+            try
+            {
+                result = conn.checkpoint(mode);
+            }
+            catch (...)
+            {
+                failed = true;
+            }
+            lock.lock();
+
+            record(mode, result, failed);
+            if (mode == CheckpointRestart && (failed || result.busy))
+            {
+                // readers still use the WAL; retrying right away would only
+                // block writers again
+                restartBackoffUntil = Clock::now() + policy.restartBackoff;
+            }
+        }
+    }
+
+    // must be called with mutex held
+    void record(CheckpointMode mode, const CheckpointResult &result, bool failed)
+    {
+        switch (mode)
+        {
+        case CheckpointRestart:
+            ++stats.restart;
+            break;
+        case CheckpointTruncate:
+            ++stats.truncate;
+            break;
+        case CheckpointPassive:
+        case CheckpointFull:
+        default:
+            ++stats.passive;
+            break;
+        }
+
+        if (failed)
+        {
+            ++stats.failed;
+            return;
+        }
+        if (result.walFrames < 0) return;  // not in WAL mode
+
+        if (result.busy || result.checkpointedFrames < result.walFrames) ++stats.starved;
+
+        if (mode == CheckpointTruncate && !result.busy)
+        {
+            // SQLite reports the frames of the WAL after truncating it, which are none
+            stats.framesCheckpointed += std::max(0, stats.walFrames - backfilledFrames);
+            stats.walFrames = 0;
+            backfilledFrames = 0;
+        }
+        else
+        {
+            stats.framesCheckpointed += std::max(0, result.checkpointedFrames - backfilledFrames);
+            stats.walFrames = result.walFrames;
+            backfilledFrames = result.checkpointedFrames;
+        }
+    }
+};
+
+CheckpointScheduler::CheckpointScheduler(const std::string &filename, CheckpointPolicy policy)
+    : impl(new Impl(filename, policy))
+{
+    // also makes the connection read the database, before that it can't
+    // tell that it's in WAL mode and checkpoints do nothing
+    auto mode = impl->conn.prepare("PRAGMA journal_mode")
+            .execWithSingleResult().get<std::string>(0);
+    if (mode != "wal")
+    {
+        throw Exception("CheckpointScheduler requires WAL mode, but journal mode is " + mode);
+    }
+
+    impl->conn.setBusyTimeout(policy.busyTimeoutMs);
+    impl->worker = std::thread(&Impl::run, impl.get());
+}
+
+CheckpointScheduler::~CheckpointScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        impl->stopping = true;
+    }
+    impl->wakeUp.notify_one();
+    impl->worker.join();
+}
+
+void CheckpointScheduler::attach(Connection &conn)
+{
+    conn.setWalHook(&Impl::walHook, impl.get());
+}
+
+void CheckpointScheduler::detach(Connection &conn)
+{
+    conn.setWalAutocheckpoint(DEFAULT_AUTOCHECKPOINT_FRAMES);
+}
+
+CheckpointStats CheckpointScheduler::stats() const
+{
+    std::lock_guard<std::mutex> lock(impl->mutex);
+    return impl->stats;
+}
+
+}
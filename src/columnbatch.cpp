@@ -0,0 +1,180 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include "smartsqlite/columnbatch.h"
+
+#include <cctype>
+#include <string>
+
+#include "smartsqlite/sqlite3.h"
+
+namespace SmartSqlite {
+
+namespace {
+
+bool contains(const std::string &haystack, const char *needle)
+{
+    return haystack.find(needle) != std::string::npos;
+}
+
+// Follows the affinity rules of SQLite (https://sqlite.org/datatype3.html).
+// Columns without a declared type or with numeric affinity take the type of
+// the current value. If that is NULL, the type is not known yet and Text is
+// returned as a placeholder.
+ColumnBatch::Type columnType(sqlite3_stmt *stmt, int pos, bool &known)
+{
+    known = true;
+    auto declared = sqlite3_column_decltype(stmt, pos);
+    std::string type;
+    for (auto ch = declared; ch && *ch; ++ch)
+    {
+        type.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(*ch))));
+    }
+
+    if (contains(type, "INT")) return ColumnBatch::Type::Int64;
+    if (contains(type, "CHAR") || contains(type, "CLOB") || contains(type, "TEXT"))
+    {
+        return ColumnBatch::Type::Text;
+    }
+    if (contains(type, "BLOB")) return ColumnBatch::Type::Blob;
+    if (contains(type, "REAL") || contains(type, "FLOA") || contains(type, "DOUB"))
+    {
+        return ColumnBatch::Type::Double;
+    }
+
+    switch (sqlite3_column_type(stmt, pos))
+    {
+    case SQLITE_INTEGER:
+        return ColumnBatch::Type::Int64;
+    case SQLITE_FLOAT:
+        return ColumnBatch::Type::Double;
+    case SQLITE_BLOB:
+        return ColumnBatch::Type::Blob;
+    case SQLITE_NULL:
+        known = false;
+        return ColumnBatch::Type::Text;
+    default:
+        return ColumnBatch::Type::Text;
+    }
+}
+
+}
+
+void ColumnBatch::Column::clear()
+{
+    m_int64s.clear();
+    m_doubles.clear();
+    m_offsets.assign(1, 0);
+    m_bytes.clear();
+    m_nullBitmap.clear();
+}
+
+void ColumnBatch::Column::append(sqlite3_stmt *stmt, int pos, std::size_t row)
+{
+    // must be queried before any conversion of the value
+    bool isNull = sqlite3_column_type(stmt, pos) == SQLITE_NULL;
+    if (!m_typeKnown && !isNull) inferType(stmt, pos);
+    if (row % 8 == 0) m_nullBitmap.push_back(0);
+    if (isNull) m_nullBitmap.back() |= static_cast<std::uint8_t>(1u << (row % 8));
+
+    switch (m_type)
+    {
+    case Type::Int64:
+        m_int64s.push_back(sqlite3_column_int64(stmt, pos));
+        break;
+    case Type::Double:
+        m_doubles.push_back(sqlite3_column_double(stmt, pos));
+        break;
+    default:
+    {
+        // Text and Blob
+        auto data = static_cast<const unsigned char*>(
+                    m_type == Type::Text
+                    ? static_cast<const void*>(sqlite3_column_text(stmt, pos))
+                    : sqlite3_column_blob(stmt, pos));
+        auto size = static_cast<std::size_t>(sqlite3_column_bytes(stmt, pos));
+        if (data) m_bytes.insert(m_bytes.end(), data, data + size);
+        m_offsets.push_back(m_bytes.size());
+        break;
+    }
+    }
+}
+
+void ColumnBatch::Column::inferType(sqlite3_stmt *stmt, int pos)
+{
+    m_type = columnType(stmt, pos, m_typeKnown);
+
+    // all previous values are NULL placeholders of an empty Text column
+    auto rows = m_offsets.size() - 1;
+    switch (m_type)
+    {
+    case Type::Int64:
+        m_int64s.assign(rows, 0);
+        m_offsets.assign(1, 0);
+        break;
+    case Type::Double:
+        m_doubles.assign(rows, 0.0);
+        m_offsets.assign(1, 0);
+        break;
+    case Type::Text:
+    case Type::Blob:
+    default:
+        break;
+    }
+}
+
+void ColumnBatch::clear()
+{
+    for (auto &column : m_columns)
+    {
+        column.clear();
+    }
+    m_rows = 0;
+}
+
+void ColumnBatch::setColumns(sqlite3_stmt *stmt)
+{
+    int count = sqlite3_column_count(stmt);
+    m_columns.clear();
+    m_columns.resize(static_cast<std::size_t>(count));
+    for (int pos = 0; pos < count; ++pos)
+    {
+        auto &column = m_columns[static_cast<std::size_t>(pos)];
+        auto name = sqlite3_column_name(stmt, pos);
+        auto declaredType = sqlite3_column_decltype(stmt, pos);
+        column.m_name = name ? name : "";
+        column.m_declaredType = declaredType ? declaredType : "";
+        column.m_type = columnType(stmt, pos, column.m_typeKnown);
+        column.clear();
+    }
+    m_rows = 0;
+}
+
+bool ColumnBatch::hasColumns(sqlite3_stmt *stmt) const
+{
+    if (m_columns.size() != static_cast<std::size_t>(sqlite3_column_count(stmt))) return false;
+
+    for (std::size_t pos = 0; pos < m_columns.size(); ++pos)
+    {
+        auto posInt = static_cast<int>(pos);
+        auto name = sqlite3_column_name(stmt, posInt);
+        auto declaredType = sqlite3_column_decltype(stmt, posInt);
+        if (m_columns[pos].m_name != (name ? name : "")) return false;
+        if (m_columns[pos].m_declaredType != (declaredType ? declaredType : "")) return false;
+    }
+    return true;
+}
+
+void ColumnBatch::append(sqlite3_stmt *stmt)
+{
+    for (std::size_t pos = 0; pos < m_columns.size(); ++pos)
+    {
+        m_columns[pos].append(stmt, static_cast<int>(pos), m_rows);
+    }
+    ++m_rows;
+}
+
+}
@@ -6,47 +6,227 @@
  */
 #include "smartsqlite/connection.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <sstream>
+#include <thread>
 
+#include "carray.h"
 #include "smartsqlite/exceptions.h"
 #include "smartsqlite/sqlite3.h"
 #include "smartsqlite/util.h"
 
 namespace SmartSqlite {
 
+namespace {
+const std::size_t DEFAULT_STATEMENT_CACHE_CAPACITY = 64;
+const std::size_t EXEC_STATEMENT_CACHE_CAPACITY = 16;
+}
+
+static_assert(PreparePersistent == SQLITE_PREPARE_PERSISTENT,
+              "PreparePersistent must match SQLITE_PREPARE_PERSISTENT");
+static_assert(PrepareNoVtab == SQLITE_PREPARE_NO_VTAB,
+              "PrepareNoVtab must match SQLITE_PREPARE_NO_VTAB");
+static_assert(CheckpointPassive == SQLITE_CHECKPOINT_PASSIVE,
+              "CheckpointPassive must match SQLITE_CHECKPOINT_PASSIVE");
+static_assert(CheckpointFull == SQLITE_CHECKPOINT_FULL,
+              "CheckpointFull must match SQLITE_CHECKPOINT_FULL");
+static_assert(CheckpointRestart == SQLITE_CHECKPOINT_RESTART,
+              "CheckpointRestart must match SQLITE_CHECKPOINT_RESTART");
+static_assert(CheckpointTruncate == SQLITE_CHECKPOINT_TRUNCATE,
+              "CheckpointTruncate must match SQLITE_CHECKPOINT_TRUNCATE");
+
+struct Connection::ProgressState
+{
+    ProgressCallback *callback = nullptr;
+    void *extraArg = nullptr;
+    int instructions = 1000;
+    bool hasDeadline = false;
+    std::chrono::steady_clock::time_point deadline;
+
+    // returning non-zero interrupts the running statement
+    static int handler(void *arg)
+    {
+        auto state = static_cast<ProgressState *>(arg);
+        if (state->hasDeadline && std::chrono::steady_clock::now() >= state->deadline)
+        {
+            return 1;
+        }
+        if (state->callback && !state->callback(state->extraArg)) return 1;
+        return 0;
+    }
+};
+
+struct Connection::BusyState
+{
+    using Clock = std::chrono::steady_clock;
+
+    // custom callback, or nullptr to use backoff
+    BusyCallback *callback = nullptr;
+    void *extraArg = nullptr;
+    BusyBackoff backoff;
+    bool hasDeadline = false;
+    Clock::time_point deadline;
+    std::minstd_rand random;
+
+    // guards the stats and the current wait, which are read by busyStats()
+    mutable std::mutex mutex;
+    BusyStats stats;
+    bool waiting = false;
+    Clock::time_point waitStart;
+    std::chrono::nanoseconds waitBlocked;
+
+    BusyState()
+        : random(static_cast<std::minstd_rand::result_type>(
+                     reinterpret_cast<std::uintptr_t>(this)
+                     ^ static_cast<std::uintptr_t>(Clock::now().time_since_epoch().count())))
+    {
+    }
+
+    // returning non-zero makes SQLite try again
+    static int handler(void *arg, int count)
+    {
+        auto state = static_cast<BusyState *>(arg);
+        auto now = Clock::now();
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (count == 0)
+            {
+                // the previous wait ended with the lock being acquired
+                if (state->waiting) state->finishWait(false);
+                state->waiting = true;
+                state->waitStart = now;
+                state->waitBlocked = std::chrono::nanoseconds::zero();
+                ++state->stats.waits;
+            }
+            ++state->stats.invocations;
+        }
+
+        bool retry = state->callback
+                ? state->callback(state->extraArg, count)
+                : state->sleep(count, now);
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->waitBlocked = Clock::now() - state->waitStart;
+        if (!retry) state->finishWait(true);
+        return retry ? 1 : 0;
+    }
+
+    bool sleep(int count, Clock::time_point now)
+    {
+        auto giveUp = waitStart + backoff.timeout;
+        if (hasDeadline) giveUp = std::min(giveUp, deadline);
+        if (now >= giveUp) return false;
+
+        auto delay = static_cast<double>(backoff.initialDelay.count())
+                * std::pow(backoff.multiplier, std::min(count, 64));
+        delay = std::min(delay, static_cast<double>(backoff.maxDelay.count()));
+        delay *= std::uniform_real_distribution<double>(0.5, 1.0)(random);
+
+        auto duration = std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::microseconds(static_cast<std::int64_t>(delay)));
+        std::this_thread::sleep_for(std::min(duration, giveUp - now));
+        return true;
+    }
+
+    // must be called with mutex held
+    void finishWait(bool timedOut)
+    {
+        waiting = false;
+        if (timedOut) ++stats.timeouts;
+        record(stats, waitBlocked);
+    }
+
+    static void record(BusyStats &stats, std::chrono::nanoseconds blocked)
+    {
+        stats.blockedTime += blocked;
+        std::size_t bucket = 0;
+        while (bucket + 1 < stats.histogram.size() && blocked >= BusyStats::bucketLimit(bucket))
+        {
+            ++bucket;
+        }
+        ++stats.histogram[bucket];
+    }
+
+    BusyStats snapshot() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto result = stats;
+        if (waiting) record(result, waitBlocked);
+        return result;
+    }
+};
+
 static void sqlite3Deleter(sqlite3 *ptr)
 {
     sqlite3_close_v2(ptr);
 }
 
 Connection::Connection(const std::string &connectionString)
+    : Connection(connectionString, ConnectionOptions())
+{
+}
+
+Connection::Connection(const std::string &connectionString, const ConnectionOptions &options)
     : conn_(nullptr, sqlite3Deleter)
+    , stmtCache_(std::make_shared<StatementCache>(DEFAULT_STATEMENT_CACHE_CAPACITY))
+    , execCache_(new StatementCache(EXEC_STATEMENT_CACHE_CAPACITY))
 {
     sqlite3 *rawConn = nullptr;
-    auto result = sqlite3_open(connectionString.c_str(), &rawConn);
+    auto result = sqlite3_open_v2(
+                connectionString.c_str(),
+                &rawConn,
+                options.flags,
+                options.vfs.empty() ? nullptr : options.vfs.c_str());
     conn_ = std::unique_ptr<sqlite3, Sqlite3Deleter*>(rawConn, sqlite3Deleter);
     CHECK_RESULT(result);
 
     CHECK_RESULT_CONN(sqlite3_extended_result_codes(conn_.get(), 1), conn_.get());
+    CHECK_RESULT_CONN(registerCarray(conn_.get()), conn_.get());
+
+    // before the pragmas, so that changing the journal mode waits for locks
+    if (options.busyTimeoutMs) setBusyTimeout(*options.busyTimeoutMs);
+    auto pragmas = options.pragmas();
+    if (!pragmas.empty()) exec(pragmas);
 }
 
 Connection::Connection(Connection &&other)
     : conn_(nullptr, sqlite3Deleter)
 {
     std::swap(conn_, other.conn_);
+    std::swap(stmtCache_, other.stmtCache_);
+    std::swap(execCache_, other.execCache_);
+    std::swap(progress_, other.progress_);
+    std::swap(busy_, other.busy_);
 }
 
 Connection &Connection::operator=(Connection &&rhs)
 {
     std::swap(conn_, rhs.conn_);
+    std::swap(stmtCache_, rhs.stmtCache_);
+    std::swap(execCache_, rhs.execCache_);
+    std::swap(progress_, rhs.progress_);
+    std::swap(busy_, rhs.busy_);
     return *this;
 }
 
 Connection::~Connection()
 {
+    // Finalize idle statements so that the connection can be closed. Cached
+    // statements that are still in use are finalized when they are destroyed.
+    if (stmtCache_) stmtCache_->close();
+    if (execCache_) execCache_->close();
+
+    // statements may outlive the connection object, but not progress_ and busy_
+    if (conn_ && progress_) sqlite3_progress_handler(conn_.get(), 0, nullptr, nullptr);
+    if (conn_ && busy_) sqlite3_busy_handler(conn_.get(), nullptr, nullptr);
 }
 
 void Connection::setBusyTimeout(int ms)
@@ -54,6 +234,45 @@ void Connection::setBusyTimeout(int ms)
     CHECK_RESULT_CONN(sqlite3_busy_timeout(conn_.get(), ms), conn_.get());
 }
 
+void Connection::setBusyHandler(BusyCallback *callback, void *extraArg)
+{
+    if (!callback)
+    {
+        CHECK_RESULT_CONN(sqlite3_busy_handler(conn_.get(), nullptr, nullptr), conn_.get());
+        return;
+    }
+    installBusyHandler(callback, extraArg);
+}
+
+void Connection::setBusyBackoff(const BusyBackoff &backoff)
+{
+    installBusyHandler(nullptr, nullptr);
+    busy_->backoff = backoff;
+}
+
+BusyStats Connection::busyStats() const
+{
+    return busy_ ? busy_->snapshot() : BusyStats();
+}
+
+void Connection::installBusyHandler(BusyCallback *callback, void *extraArg)
+{
+    if (!busy_)
+    {
+        busy_.reset(new BusyState);
+        if (progress_)
+        {
+            busy_->hasDeadline = progress_->hasDeadline;
+            busy_->deadline = progress_->deadline;
+        }
+    }
+    busy_->callback = callback;
+    busy_->extraArg = extraArg;
+    CHECK_RESULT_CONN(
+                sqlite3_busy_handler(conn_.get(), &BusyState::handler, busy_.get()),
+                conn_.get());
+}
+
 void *Connection::setTracingCallback(TracingCallback *callback, void *extraArg)
 {
     return sqlite3_trace(conn_.get(), callback, extraArg);
@@ -67,44 +286,164 @@ void *Connection::setProfilingCallback(ProfilingCallback *callback, void *extraA
                 extraArg);
 }
 
-Statement Connection::prepare(const std::string &sql)
+void Connection::interrupt()
 {
-    sqlite3_stmt *stmtPtr;
-    const char *tail;
+    sqlite3_interrupt(conn_.get());
+}
 
-    // size + 1 can be passed because c_str() is known to be null-terminated.
-    // This will cause SQLite not to copy the input.
-    auto sqlSize = sql.size() + 1;
-    assert(sqlSize <= std::numeric_limits<int>::max());
-    auto sqlSizeInt = static_cast<int>(sqlSize);
-    CHECK_RESULT_CONN(sqlite3_prepare_v2(conn_.get(), sql.c_str(), sqlSizeInt, &stmtPtr, &tail),
-                      conn_.get());
-    Statement stmt(conn_.get(), stmtPtr);
+void Connection::setProgressCallback(ProgressCallback *callback, void *extraArg, int instructions)
+{
+    if (!progress_) progress_.reset(new ProgressState);
+    progress_->callback = callback;
+    progress_->extraArg = extraArg;
+    progress_->instructions = instructions;
+    updateProgressHandler();
+}
 
-    if (tail != nullptr && tail[0] != '\0')
+void Connection::setDeadline(std::chrono::steady_clock::time_point deadline)
+{
+    if (!progress_) progress_.reset(new ProgressState);
+    progress_->hasDeadline = true;
+    progress_->deadline = deadline;
+    updateProgressHandler();
+    if (busy_)
     {
-        throw Exception("Connection::prepare() doesn't support multiple SQL statements in a single call.");
+        busy_->hasDeadline = true;
+        busy_->deadline = deadline;
     }
-
-    return stmt;
 }
 
-void Connection::exec(const std::string &sql)
+void Connection::clearDeadline()
 {
-    char *errmsg;
-    int result = sqlite3_exec(conn_.get(), sql.c_str(), nullptr, nullptr, &errmsg);
+    if (busy_) busy_->hasDeadline = false;
+    if (!progress_) return;
+    progress_->hasDeadline = false;
+    updateProgressHandler();
+}
 
-    std::unique_ptr<char, void(*)(void*)> errmsgSafe(errmsg, sqlite3_free);
-    if (errmsgSafe)
+void Connection::updateProgressHandler()
+{
+    // only install the handler while it's needed, it slows down statements
+    if (progress_->callback || progress_->hasDeadline)
     {
-        CHECK_RESULT_MSG(result, std::string(errmsgSafe.get()) + "\nSQL: " + sql);
+        sqlite3_progress_handler(
+                    conn_.get(), progress_->instructions,
+                    &ProgressState::handler, progress_.get());
     }
     else
     {
-        CHECK_RESULT(result);
+        sqlite3_progress_handler(conn_.get(), 0, nullptr, nullptr);
+    }
+}
+
+Statement Connection::prepare(const std::string &sql)
+{
+    return prepare(sql, 0);
+}
+
+Statement Connection::prepare(const std::string &sql, unsigned int flags)
+{
+    return Statement(conn_.get(), prepareHandle(sql, flags));
+}
+
+void Connection::exec(const std::string &sql)
+{
+    exec(sql, RowCallback());
+}
+
+void Connection::exec(const std::string &sql, const RowCallback &callback)
+{
+    // Statements are compiled right before they are run, so that later
+    // statements can refer to tables created by earlier ones. Only texts that
+    // consist of a single statement are kept in execCache_ for the next call,
+    // so that the parts of multi-statement SQL don't fill it up.
+    const char *begin = sql.c_str();
+    const char *end = begin + sql.size();
+    while (begin < end)
+    {
+        std::shared_ptr<StatementMetadata> metadata;
+        sqlite3_stmt *stmtPtr = execCache_->acquire(std::string(begin, end), metadata);
+        bool cacheable = true;
+        if (stmtPtr)
+        {
+            begin = end;
+        }
+        else
+        {
+            // see prepare() on why the terminating null is included
+            auto sqlSize = end - begin + 1;
+            assert(sqlSize <= std::numeric_limits<int>::max());
+
+            const char *tail = nullptr;
+            int result = sqlite3_prepare_v3(
+                        conn_.get(), begin, static_cast<int>(sqlSize), 0, &stmtPtr, &tail);
+            if (result != SQLITE_OK)
+            {
+                CHECK_RESULT_MSG(result, std::string(sqlite3_errmsg(conn_.get())) + "\nSQL: " + begin);
+            }
+            begin = tail ? tail : end;
+            cacheable = begin == end;
+
+            // whitespace and comments don't yield a statement
+            if (!stmtPtr) continue;
+        }
+
+        // returns the statement to execCache_, or finalizes it if it only
+        // is a part of sql
+        auto releaseStmt = [&](sqlite3_stmt *stmt) {
+            if (cacheable) execCache_->release(stmt, nullptr);
+            else sqlite3_finalize(stmt);
+        };
+        std::unique_ptr<sqlite3_stmt, decltype(releaseStmt)> stmt(stmtPtr, releaseStmt);
+
+        Row row(stmt.get());
+        row.setColumns(sqlite3_column_count(stmt.get()));
+        int result;
+        while ((result = sqlite3_step(stmt.get())) == SQLITE_ROW)
+        {
+            if (callback) callback(row);
+        }
+        if (result != SQLITE_DONE)
+        {
+            CHECK_RESULT_STMT(result, conn_.get(), stmt.get());
+        }
     }
 }
 
+Script Connection::prepareScript(const std::string &sql)
+{
+    return Script(conn_.get(), sql);
+}
+
+Statement Connection::prepareCached(const std::string &sql)
+{
+    std::shared_ptr<StatementMetadata> metadata;
+    auto stmtPtr = stmtCache_->acquire(sql, metadata);
+    if (!stmtPtr) stmtPtr = prepareHandle(sql, PreparePersistent);
+    return Statement(conn_.get(), stmtPtr, stmtCache_, std::move(metadata));
+}
+
+void Connection::setStatementCacheCapacity(std::size_t capacity)
+{
+    stmtCache_->setCapacity(capacity);
+}
+
+StatementCacheStats Connection::statementCacheStats() const
+{
+    return stmtCache_->stats();
+}
+
+StatementCacheStats Connection::execCacheStats() const
+{
+    return execCache_->stats();
+}
+
+void Connection::clearStatementCache()
+{
+    stmtCache_->clear();
+    execCache_->clear();
+}
+
 void Connection::setKey(const std::string &keyBase64)
 {
 #if defined(SQLITE_HAS_CODEC) && SQLITE_HAS_CODEC
@@ -177,6 +516,11 @@ void Connection::rollbackToSavepoint(const std::string &name)
     exec(std::string("ROLLBACK TRANSACTION TO SAVEPOINT '") + escape(name) + "'");
 }
 
+bool Connection::isAutocommit() const
+{
+    return sqlite3_get_autocommit(conn_.get()) != 0;
+}
+
 std::int64_t Connection::lastInsertRowId() const
 {
     return sqlite3_last_insert_rowid(conn_.get());
@@ -187,6 +531,129 @@ int Connection::changes() const
     return sqlite3_changes(conn_.get());
 }
 
+void Connection::setWalAutocheckpoint(int frames)
+{
+    CHECK_RESULT_CONN(sqlite3_wal_autocheckpoint(conn_.get(), frames), conn_.get());
+}
+
+void *Connection::setWalHook(WalCallback *callback, void *extraArg)
+{
+    return sqlite3_wal_hook(conn_.get(), callback, extraArg);
+}
+
+CheckpointResult Connection::checkpoint(CheckpointMode mode, const std::string &schema)
+{
+    CheckpointResult result;
+    auto status = sqlite3_wal_checkpoint_v2(
+                conn_.get(),
+                schema.empty() ? nullptr : schema.c_str(),
+                mode,
+                &result.walFrames,
+                &result.checkpointedFrames);
+    if ((status & 0xff) == SQLITE_BUSY) result.busy = true;
+    else CHECK_RESULT_CONN(status, conn_.get());
+    return result;
+}
+
+std::vector<unsigned char> Connection::serialize(const std::string &schema, SerializeMode mode)
+{
+    if (mode == SerializeStored) return serializeStored(schema);
+
+    // Databases loaded using deserialize() are stored in a single buffer
+    // that can be copied directly. For all others, including plain
+    // ":memory:" databases, NOCOPY returns nullptr and SQLite reads the
+    // pages into a buffer of its own.
+    sqlite3_int64 size = -1;
+    auto data = sqlite3_serialize(conn_.get(), schema.c_str(), &size, SQLITE_SERIALIZE_NOCOPY);
+    if (data) return std::vector<unsigned char>(data, data + size);
+
+    std::unique_ptr<unsigned char, void(*)(void *)> copy(
+                sqlite3_serialize(conn_.get(), schema.c_str(), &size, 0),
+                sqlite3_free);
+    if (!copy)
+    {
+        if (size == 0) return std::vector<unsigned char>();
+        throw SqliteException(__func__, SQLITE_ERROR, "Couldn't serialize schema " + schema);
+    }
+    return std::vector<unsigned char>(copy.get(), copy.get() + size);
+}
+
+std::vector<unsigned char> Connection::serializeStored(const std::string &schema)
+{
+    if (!isAutocommit())
+    {
+        throw Exception("Can't serialize the stored database file in a transaction, "
+                        "it may contain uncommitted changes");
+    }
+
+    const std::string quotedSchema = "\"" + quoteIdentifier(schema) + "\"";
+    auto journalMode = prepare("PRAGMA " + quotedSchema + ".journal_mode")
+            .execWithSingleResult().get<std::string>(0);
+    if (journalMode == "wal")
+    {
+        throw Exception("Can't serialize the stored database file in WAL mode, "
+                        "recent commits may only be in the WAL");
+    }
+
+    // the shared lock of a read transaction keeps writers out of the file
+    beginTransaction();
+    try
+    {
+        prepare("SELECT count(*) FROM " + quotedSchema + ".sqlite_master").execWithSingleResult();
+
+        sqlite3_file *file = nullptr;
+        CHECK_RESULT_CONN(
+                    sqlite3_file_control(
+                        conn_.get(), schema.c_str(), SQLITE_FCNTL_FILE_POINTER, &file),
+                    conn_.get());
+        if (!file || !file->pMethods)
+        {
+            throw Exception("Can't serialize the stored database file, schema "
+                            + schema + " has none");
+        }
+
+        sqlite3_int64 size = 0;
+        CHECK_RESULT(file->pMethods->xFileSize(file, &size));
+        std::vector<unsigned char> buffer(static_cast<std::size_t>(size));
+
+        // xRead takes int amounts, so read in chunks
+        const sqlite3_int64 CHUNK_SIZE = 1 << 20;
+        for (sqlite3_int64 offset = 0; offset < size; offset += CHUNK_SIZE)
+        {
+            auto amount = static_cast<int>(std::min(CHUNK_SIZE, size - offset));
+            CHECK_RESULT(file->pMethods->xRead(
+                             file, buffer.data() + offset, amount, offset));
+        }
+
+        rollbackTransaction();
+        return buffer;
+    }
+    catch (...)
+    {
+        if (!isAutocommit()) sqlite3_exec(conn_.get(), "ROLLBACK", nullptr, nullptr, nullptr);
+        throw;
+    }
+}
+
+void Connection::deserialize(
+        const std::vector<unsigned char> &buffer,
+        bool readOnly,
+        const std::string &schema)
+{
+    auto size = static_cast<sqlite3_int64>(buffer.size());
+    auto data = static_cast<unsigned char *>(sqlite3_malloc64(buffer.size()));
+    if (!data && size > 0) throw SqliteException(__func__, SQLITE_NOMEM);
+    if (size > 0) std::memcpy(data, buffer.data(), buffer.size());
+
+    unsigned int flags = SQLITE_DESERIALIZE_FREEONCLOSE;
+    flags |= readOnly ? SQLITE_DESERIALIZE_READONLY : SQLITE_DESERIALIZE_RESIZEABLE;
+
+    // SQLite owns data from here on, even if this fails
+    CHECK_RESULT_CONN(
+                sqlite3_deserialize(conn_.get(), schema.c_str(), data, size, size, flags),
+                conn_.get());
+}
+
 Blob Connection::openBlob(
         const std::string &db,
         const std::string &table,
@@ -208,6 +675,42 @@ Blob Connection::openBlob(
     return Blob(conn_.get(), blob);
 }
 
+sqlite3_stmt *Connection::prepareHandle(const std::string &sql, unsigned int flags)
+{
+    sqlite3_stmt *stmtPtr;
+    const char *tail;
+
+    // size + 1 can be passed because c_str() is known to be null-terminated.
+    // This will cause SQLite not to copy the input.
+    auto sqlSize = sql.size() + 1;
+    assert(sqlSize <= std::numeric_limits<int>::max());
+    auto sqlSizeInt = static_cast<int>(sqlSize);
+    CHECK_RESULT_CONN(
+                sqlite3_prepare_v3(conn_.get(), sql.c_str(), sqlSizeInt, flags, &stmtPtr, &tail),
+                conn_.get());
+
+    if (tail != nullptr && tail[0] != '\0')
+    {
+        sqlite3_finalize(stmtPtr);
+        throw Exception("Connection::prepare() doesn't support multiple SQL statements in a single call.");
+    }
+
+    return stmtPtr;
+}
+
+std::string Connection::quoteIdentifier(const std::string &original)
+{
+    std::string result;
+    result.reserve(original.size());
+    for (auto ch : original)
+    {
+        // escape double quote by two double quotes
+        if (ch == '"') result.push_back('"');
+        result.push_back(ch);
+    }
+    return result;
+}
+
 std::string Connection::escape(const std::string &original)
 {
     std::stringstream result;
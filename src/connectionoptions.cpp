@@ -0,0 +1,122 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include "smartsqlite/connectionoptions.h"
+
+#include "smartsqlite/sqlite3.h"
+
+namespace SmartSqlite {
+
+static_assert(OpenReadOnly == SQLITE_OPEN_READONLY, "OpenReadOnly must match SQLITE_OPEN_READONLY");
+static_assert(OpenReadWrite == SQLITE_OPEN_READWRITE, "OpenReadWrite must match SQLITE_OPEN_READWRITE");
+static_assert(OpenCreate == SQLITE_OPEN_CREATE, "OpenCreate must match SQLITE_OPEN_CREATE");
+static_assert(OpenUri == SQLITE_OPEN_URI, "OpenUri must match SQLITE_OPEN_URI");
+static_assert(OpenMemory == SQLITE_OPEN_MEMORY, "OpenMemory must match SQLITE_OPEN_MEMORY");
+static_assert(OpenNoMutex == SQLITE_OPEN_NOMUTEX, "OpenNoMutex must match SQLITE_OPEN_NOMUTEX");
+static_assert(OpenFullMutex == SQLITE_OPEN_FULLMUTEX, "OpenFullMutex must match SQLITE_OPEN_FULLMUTEX");
+static_assert(OpenSharedCache == SQLITE_OPEN_SHAREDCACHE, "OpenSharedCache must match SQLITE_OPEN_SHAREDCACHE");
+static_assert(OpenPrivateCache == SQLITE_OPEN_PRIVATECACHE, "OpenPrivateCache must match SQLITE_OPEN_PRIVATECACHE");
+
+namespace {
+
+const char *journalModeName(JournalMode mode)
+{
+    switch (mode)
+    {
+    case JournalModeDelete: return "DELETE";
+    case JournalModeTruncate: return "TRUNCATE";
+    case JournalModePersist: return "PERSIST";
+    case JournalModeMemory: return "MEMORY";
+    case JournalModeWal: return "WAL";
+    case JournalModeOff: return "OFF";
+    case JournalModeUnchanged:
+    default:
+        return nullptr;
+    }
+}
+
+const char *synchronousName(Synchronous synchronous)
+{
+    switch (synchronous)
+    {
+    case SynchronousOff: return "OFF";
+    case SynchronousNormal: return "NORMAL";
+    case SynchronousFull: return "FULL";
+    case SynchronousExtra: return "EXTRA";
+    case SynchronousUnchanged:
+    default:
+        return nullptr;
+    }
+}
+
+const char *tempStoreName(TempStore tempStore)
+{
+    switch (tempStore)
+    {
+    case TempStoreDefault: return "DEFAULT";
+    case TempStoreFile: return "FILE";
+    case TempStoreMemory: return "MEMORY";
+    case TempStoreUnchanged:
+    default:
+        return nullptr;
+    }
+}
+
+void appendPragma(std::string &sql, const char *name, const std::string &value)
+{
+    sql += "PRAGMA ";
+    sql += name;
+    sql += " = ";
+    sql += value;
+    sql += ";";
+}
+
+}
+
+ConnectionOptions ConnectionOptions::readHeavyWal()
+{
+    ConnectionOptions options;
+    options.busyTimeoutMs.setValue(5000);
+    options.journalMode = JournalModeWal;
+    options.synchronous = SynchronousNormal;
+    options.cacheSize.setValue(-64 * 1024);
+    options.mmapSize.setValue(256 * 1024 * 1024);
+    options.tempStore = TempStoreMemory;
+    return options;
+}
+
+ConnectionOptions ConnectionOptions::bulkLoad()
+{
+    ConnectionOptions options;
+    options.journalMode = JournalModeMemory;
+    options.synchronous = SynchronousOff;
+    options.cacheSize.setValue(-256 * 1024);
+    options.tempStore = TempStoreMemory;
+    return options;
+}
+
+ConnectionOptions ConnectionOptions::lowMemory()
+{
+    ConnectionOptions options;
+    options.cacheSize.setValue(-512);
+    options.mmapSize.setValue(0);
+    options.tempStore = TempStoreFile;
+    return options;
+}
+
+std::string ConnectionOptions::pragmas() const
+{
+    std::string sql;
+    if (pageSize) appendPragma(sql, "page_size", std::to_string(*pageSize));
+    if (auto mode = journalModeName(journalMode)) appendPragma(sql, "journal_mode", mode);
+    if (auto sync = synchronousName(synchronous)) appendPragma(sql, "synchronous", sync);
+    if (cacheSize) appendPragma(sql, "cache_size", std::to_string(*cacheSize));
+    if (mmapSize) appendPragma(sql, "mmap_size", std::to_string(*mmapSize));
+    if (auto store = tempStoreName(tempStore)) appendPragma(sql, "temp_store", store);
+    return sql;
+}
+
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include "smartsqlite/connectionpool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "smartsqlite/exceptions.h"
+
+namespace SmartSqlite {
+
+struct ConnectionPool::Impl
+{
+    std::unique_ptr<Connection> writer;
+    std::vector<std::unique_ptr<Connection>> readers;
+
+    mutable std::mutex mutex;
+    std::condition_variable returned;
+    bool writerIdle = true;
+    std::vector<Connection *> idleReaders;
+    // SQL text -> whether it is read-only
+    std::unordered_map<std::string, bool> routes;
+    ConnectionPoolStats stats;
+};
+
+PooledConnection::PooledConnection(
+        ConnectionPool *pool,
+        Connection *conn,
+        bool isWriter,
+        std::chrono::nanoseconds waitTime)
+    : m_pool(pool), m_conn(conn), m_isWriter(isWriter), m_waitTime(waitTime)
+{
+}
+
+PooledConnection::PooledConnection(PooledConnection &&other)
+    : m_pool(other.m_pool)
+    , m_conn(other.m_conn)
+    , m_isWriter(other.m_isWriter)
+    , m_waitTime(other.m_waitTime)
+{
+    other.m_pool = nullptr;
+    other.m_conn = nullptr;
+}
+
+PooledConnection &PooledConnection::operator=(PooledConnection &&rhs)
+{
+    std::swap(m_pool, rhs.m_pool);
+    std::swap(m_conn, rhs.m_conn);
+    std::swap(m_isWriter, rhs.m_isWriter);
+    std::swap(m_waitTime, rhs.m_waitTime);
+    return *this;
+}
+
+PooledConnection::~PooledConnection()
+{
+    if (m_pool) m_pool->checkin(m_conn, m_isWriter);
+}
+
+PooledStatement::PooledStatement(PooledConnection conn, Statement stmt)
+    : m_conn(std::move(conn)), m_stmt(std::move(stmt))
+{
+}
+
+ConnectionPool::ConnectionPool(const std::string &filename, std::size_t readers)
+    : impl(new Impl)
+{
+    impl->writer.reset(new Connection(filename));
+    impl->writer->exec("PRAGMA journal_mode = WAL");
+    auto mode = impl->writer->prepare("PRAGMA journal_mode")
+            .execWithSingleResult().get<std::string>(0);
+    if (mode != "wal")
+    {
+        throw Exception("ConnectionPool requires WAL mode, but journal mode is " + mode);
+    }
+
+    // a pooled connection is only used by one thread at a time
+    ConnectionOptions readerOptions;
+    readerOptions.flags = OpenReadOnly | OpenNoMutex;
+    for (std::size_t i = 0; i < readers; ++i)
+    {
+        std::unique_ptr<Connection> reader(new Connection(filename, readerOptions));
+        impl->idleReaders.push_back(reader.get());
+        impl->readers.push_back(std::move(reader));
+    }
+}
+
+ConnectionPool::~ConnectionPool()
+{
+}
+
+PooledConnection ConnectionPool::reader()
+{
+    return checkout(ReaderKind);
+}
+
+PooledConnection ConnectionPool::writer()
+{
+    return checkout(WriterKind);
+}
+
+PooledStatement ConnectionPool::prepare(const std::string &sql)
+{
+    // without readers, everything goes to the writer
+    bool readOnly = false;
+    if (!impl->readers.empty())
+    {
+        bool known = false;
+        {
+            std::lock_guard<std::mutex> lock(impl->mutex);
+            auto route = impl->routes.find(sql);
+            if (route != impl->routes.end())
+            {
+                known = true;
+                readOnly = route->second;
+            }
+        }
+
+        if (!known)
+        {
+            // Compiled on whichever connection is idle first, so that callers
+            // holding all readers don't deadlock. If that connection is of
+            // the right kind, the statement is used right away instead of
+            // being compiled again. It isn't cached, which keeps write
+            // statements out of the readers' caches.
+            auto conn = checkout(AnyKind);
+            auto stmt = conn->prepare(sql);
+            readOnly = stmt.isReadOnly();
+            {
+                std::lock_guard<std::mutex> lock(impl->mutex);
+                impl->routes[sql] = readOnly;
+            }
+            if (readOnly != conn.isWriter())
+            {
+                return PooledStatement(std::move(conn), std::move(stmt));
+            }
+        }
+    }
+
+    auto conn = checkout(readOnly ? ReaderKind : WriterKind);
+    auto stmt = conn->prepareCached(sql);
+    return PooledStatement(std::move(conn), std::move(stmt));
+}
+
+ConnectionPoolStats ConnectionPool::stats() const
+{
+    std::lock_guard<std::mutex> lock(impl->mutex);
+    return impl->stats;
+}
+
+PooledConnection ConnectionPool::checkout(Kind kind)
+{
+    auto start = std::chrono::steady_clock::now();
+    bool waited = false;
+
+    std::unique_lock<std::mutex> lock(impl->mutex);
+    auto available = [this, kind] {
+        switch (kind)
+        {
+        case ReaderKind:
+            return !impl->idleReaders.empty();
+        case WriterKind:
+            return impl->writerIdle;
+        case AnyKind:
+        default:
+            return impl->writerIdle || !impl->idleReaders.empty();
+        }
+    };
+    if (!available())
+    {
+        waited = true;
+        impl->returned.wait(lock, available);
+    }
+
+    // AnyKind prefers readers, which are more numerous
+    bool writer = kind == WriterKind
+            || (kind == AnyKind && impl->idleReaders.empty());
+    Connection *conn;
+    if (writer)
+    {
+        impl->writerIdle = false;
+        conn = impl->writer.get();
+    }
+    else
+    {
+        conn = impl->idleReaders.back();
+        impl->idleReaders.pop_back();
+    }
+
+    auto waitTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start);
+    auto &stats = impl->stats;
+    if (writer)
+    {
+        ++stats.writerCheckouts;
+        if (waited) ++stats.writerWaits;
+        stats.writerWaitTime += waitTime;
+    }
+    else
+    {
+        ++stats.readerCheckouts;
+        if (waited) ++stats.readerWaits;
+        stats.readerWaitTime += waitTime;
+    }
+    stats.maxWaitTime = std::max(stats.maxWaitTime, waitTime);
+
+    return PooledConnection(this, conn, writer, waitTime);
+}
+
+void ConnectionPool::checkin(Connection *conn, bool isWriter)
+{
+    {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        if (isWriter) impl->writerIdle = true;
+        else impl->idleReaders.push_back(conn);
+    }
+    // readers and the writer wait on the same condition
+    impl->returned.notify_all();
+}
+
+}
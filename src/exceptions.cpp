@@ -28,6 +28,22 @@ ParameterUnknown::ParameterUnknown(const std::string &parameter)
 {
 }
 
+ParameterCountMismatch::ParameterCountMismatch(int expected, std::size_t actual, const std::string &sql)
+    : Exception(
+          std::string("Statement expects ") + std::to_string(expected) +
+          " parameters, but " + std::to_string(actual) + " were given.",
+          sql)
+{
+}
+
+ColumnCountMismatch::ColumnCountMismatch(std::size_t expected, int actual, const std::string &sql)
+    : Exception(
+          std::string("Expected ") + std::to_string(expected) +
+          " result columns, but statement returns " + std::to_string(actual) + ".",
+          sql)
+{
+}
+
 ColumnUnknown::ColumnUnknown(int &columnPos)
     : Exception(
           std::string("Column not found in result: ") +
@@ -52,6 +68,15 @@ QueryReturnedNoRows::QueryReturnedNoRows(const std::string &sql)
 {
 }
 
+BorrowedBindingModified::BorrowedBindingModified(int parameterPos, const std::string &sql)
+    : Exception(
+          std::string("Borrowed data bound to parameter ") +
+          std::to_string(parameterPos) +
+          " was modified before the statement was reset.",
+          sql)
+{
+}
+
 SqliteException::SqliteException(const std::string &func, int resultCode)
     : Exception(
           std::string("[") + func + "] " +
@@ -22,7 +22,8 @@ double NativeExtractor::extractDouble(sqlite3_stmt *stmt, int pos)
 
 std::string NativeExtractor::extractString(sqlite3_stmt *stmt, int pos)
 {
-    return std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, pos)));
+    auto view = extractStringView(stmt, pos);
+    return std::string(view.data(), view.size());
 }
 
 std::vector<unsigned char> NativeExtractor::extractBlob(sqlite3_stmt *stmt, int pos)
@@ -34,4 +35,46 @@ std::vector<unsigned char> NativeExtractor::extractBlob(sqlite3_stmt *stmt, int
     return std::vector<unsigned char>(data, data + size);
 }
 
+StringView NativeExtractor::extractStringView(sqlite3_stmt *stmt, int pos)
+{
+    // sqlite3_column_bytes() must be called after sqlite3_column_text(),
+    // otherwise the size may refer to a different encoding of the value
+    auto data = reinterpret_cast<const char*>(sqlite3_column_text(stmt, pos));
+    if (!data) return StringView();
+    auto size = static_cast<std::size_t>(sqlite3_column_bytes(stmt, pos));
+    return StringView(data, size);
+}
+
+BlobView NativeExtractor::extractBlobView(sqlite3_stmt *stmt, int pos)
+{
+    auto data = sqlite3_column_blob(stmt, pos);
+    if (!data) return BlobView();
+    auto size = static_cast<std::size_t>(sqlite3_column_bytes(stmt, pos));
+    return BlobView(data, size);
+}
+
+void NativeExtractor::extractStringInto(sqlite3_stmt *stmt, int pos, std::string &target)
+{
+    auto data = reinterpret_cast<const char*>(sqlite3_column_text(stmt, pos));
+    if (!data)
+    {
+        target.clear();
+        return;
+    }
+    auto size = static_cast<std::size_t>(sqlite3_column_bytes(stmt, pos));
+    target.assign(data, size);
+}
+
+void NativeExtractor::extractBlobInto(sqlite3_stmt *stmt, int pos, std::vector<unsigned char> &target)
+{
+    auto data = static_cast<const unsigned char*>(sqlite3_column_blob(stmt, pos));
+    if (!data)
+    {
+        target.clear();
+        return;
+    }
+    auto size = static_cast<std::size_t>(sqlite3_column_bytes(stmt, pos));
+    target.assign(data, data + size);
+}
+
 }
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include "smartsqlite/resultset.h"
+
+#include <stdexcept>
+#include <vector>
+
+#include "smartsqlite/sqlite3.h"
+
+namespace SmartSqlite {
+
+namespace {
+
+// values larger than a chunk get a chunk of their own
+const std::size_t ARENA_CHUNK_SIZE = 64 * 1024;
+
+}
+
+struct ResultSet::Storage
+{
+    std::vector<std::string> columnNames;
+    // row-major
+    std::vector<Value> values;
+
+    std::vector<std::unique_ptr<unsigned char[]>> chunks;
+    std::size_t chunkBytes = 0;
+    unsigned char *cursor = nullptr;
+    std::size_t remaining = 0;
+
+    const unsigned char *store(const void *data, std::size_t size)
+    {
+        if (size > remaining)
+        {
+            auto chunkSize = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+            chunks.emplace_back(new unsigned char[chunkSize]);
+            chunkBytes += chunkSize;
+            cursor = chunks.back().get();
+            remaining = chunkSize;
+        }
+
+        auto result = cursor;
+        std::memcpy(cursor, data, size);
+        cursor += size;
+        remaining -= size;
+        return result;
+    }
+};
+
+ResultSet::ResultSet()
+{
+}
+
+ResultSet::ResultSet(std::shared_ptr<const Storage> storage)
+    : m_storage(std::move(storage))
+{
+    auto columns = m_storage->columnNames.size();
+    m_rows = columns ? m_storage->values.size() / columns : 0;
+}
+
+std::size_t ResultSet::columnCount() const
+{
+    return m_storage ? m_storage->columnNames.size() : 0;
+}
+
+const std::string &ResultSet::columnName(std::size_t column) const
+{
+    if (column >= columnCount()) throw std::out_of_range("ResultSet column out of range");
+    return m_storage->columnNames[column];
+}
+
+const Value &ResultSet::at(std::size_t row, std::size_t column) const
+{
+    if (row >= m_rows) throw std::out_of_range("ResultSet row out of range");
+    if (column >= columnCount()) throw std::out_of_range("ResultSet column out of range");
+    return m_storage->values[(m_firstRow + row) * columnCount() + column];
+}
+
+ResultSet ResultSet::slice(std::size_t firstRow, std::size_t rowCount) const
+{
+    if (firstRow > m_rows || rowCount > m_rows - firstRow)
+    {
+        throw std::out_of_range("ResultSet slice out of range");
+    }
+
+    ResultSet result(*this);
+    result.m_firstRow = m_firstRow + firstRow;
+    result.m_rows = rowCount;
+    return result;
+}
+
+std::size_t ResultSet::memoryUsage() const
+{
+    if (!m_storage) return 0;
+
+    std::size_t result = sizeof(Storage) + m_storage->chunkBytes;
+    result += m_storage->values.capacity() * sizeof(Value);
+    result += m_storage->chunks.capacity() * sizeof(m_storage->chunks[0]);
+    result += m_storage->columnNames.capacity() * sizeof(std::string);
+    for (const auto &name : m_storage->columnNames)
+    {
+        result += name.capacity();
+    }
+    return result;
+}
+
+std::shared_ptr<ResultSet::Storage> ResultSet::createStorage(sqlite3_stmt *stmt)
+{
+    auto storage = std::make_shared<Storage>();
+    int count = sqlite3_column_count(stmt);
+    storage->columnNames.reserve(static_cast<std::size_t>(count));
+    for (int pos = 0; pos < count; ++pos)
+    {
+        auto name = sqlite3_column_name(stmt, pos);
+        storage->columnNames.push_back(name ? name : "");
+    }
+    return storage;
+}
+
+void ResultSet::appendRow(Storage &storage, sqlite3_stmt *stmt)
+{
+    int count = static_cast<int>(storage.columnNames.size());
+    for (int pos = 0; pos < count; ++pos)
+    {
+        Value value;
+        switch (sqlite3_column_type(stmt, pos))
+        {
+        case SQLITE_INTEGER:
+            value.m_type = Value::Type::Integer;
+            value.m_int64 = sqlite3_column_int64(stmt, pos);
+            break;
+        case SQLITE_FLOAT:
+            value.m_type = Value::Type::Float;
+            value.m_double = sqlite3_column_double(stmt, pos);
+            break;
+        case SQLITE_TEXT:
+        case SQLITE_BLOB:
+        {
+            bool isText = sqlite3_column_type(stmt, pos) == SQLITE_TEXT;
+            const void *data = isText
+                    ? static_cast<const void*>(sqlite3_column_text(stmt, pos))
+                    : sqlite3_column_blob(stmt, pos);
+            auto size = static_cast<std::size_t>(sqlite3_column_bytes(stmt, pos));
+
+            value.m_type = isText ? Value::Type::Text : Value::Type::Blob;
+            value.m_size = static_cast<std::uint32_t>(size);
+            if (size <= Value::INLINE_CAPACITY)
+            {
+                if (size) std::memcpy(value.m_inline, data, size);
+            }
+            else
+            {
+                value.m_external = storage.store(data, size);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        storage.values.push_back(value);
+    }
+}
+
+}
@@ -12,11 +12,17 @@
 #include "smartsqlite/exceptions.h"
 #include "smartsqlite/sqlite3.h"
 #include "smartsqlite/util.h"
+#include "statementmetadata.h"
 
 namespace SmartSqlite {
 
 RowIterator::RowIterator(sqlite3 *conn, sqlite3_stmt *stmt, Done done)
-    : m_conn(conn), m_stmt(stmt), m_done(done == Done::True), m_row(stmt)
+    : RowIterator(conn, stmt, done, nullptr)
+{
+}
+
+RowIterator::RowIterator(sqlite3 *conn, sqlite3_stmt *stmt, Done done, StatementMetadata *metadata)
+    : m_conn(conn), m_stmt(stmt), m_done(done == Done::True), m_row(stmt, metadata)
 {
 }
 
@@ -32,6 +38,8 @@ bool RowIterator::operator!=(const RowIterator &rhs) const
 
 RowIterator &RowIterator::operator++()
 {
+    if (m_row.m_metadata) m_row.m_metadata->invalidateRows();
+
     int result = sqlite3_step(m_stmt);
     switch (result)
     {
@@ -44,7 +52,13 @@ RowIterator &RowIterator::operator++()
     default:
         CHECK_RESULT_STMT(result, m_conn, m_stmt);
     }
-    m_row.setColumns(sqlite3_column_count(m_stmt));
+
+    // the column count can't change during an execution
+    if (!m_columnsKnown)
+    {
+        m_row.setColumns(sqlite3_column_count(m_stmt));
+        m_columnsKnown = true;
+    }
     return *this;
 }
 
@@ -63,11 +77,26 @@ Row::Row(sqlite3_stmt *stmt)
 {
 }
 
+Row::Row(sqlite3_stmt *stmt, StatementMetadata *metadata)
+    : m_stmt(stmt), m_metadata(metadata)
+{
+}
+
 bool Row::isNull(int pos) const
 {
     return sqlite3_column_type(m_stmt, pos) == SQLITE_NULL;
 }
 
+void Row::attachGuard(StringView &view) const
+{
+    if (m_metadata) view.setGuard(m_metadata->rowGuard());
+}
+
+void Row::attachGuard(BlobView &view) const
+{
+    if (m_metadata) view.setGuard(m_metadata->rowGuard());
+}
+
 void Row::setColumns(int columns)
 {
     m_columns = columns;
@@ -83,21 +112,26 @@ void Row::checkPosRange(int pos) const
 
 int Row::getPosByName(const char *column) const
 {
-    if (m_columnNames.empty())
+    int pos = -1;
+    if (m_metadata)
     {
-        for (int i = 0; i < m_columns; ++i)
-        {
-            m_columnNames[sqlite3_column_name(m_stmt, i)] = i;
-        }
+        pos = m_metadata->columnPos(m_stmt, column);
     }
-    try
+    else
     {
-        return m_columnNames.at(column);
-    }
-    catch (std::out_of_range)
-    {
-        throw ColumnUnknown(column);
+        // without shared metadata, fall back to a linear scan
+        for (int i = m_columns - 1; i >= 0; --i)
+        {
+            if (std::strcmp(sqlite3_column_name(m_stmt, i), column) == 0)
+            {
+                pos = i;
+                break;
+            }
+        }
     }
+
+    if (pos < 0 || pos >= m_columns) throw ColumnUnknown(column);
+    return pos;
 }
 
 }
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include "smartsqlite/script.h"
+
+#include <cassert>
+#include <limits>
+#include <vector>
+
+#include "smartsqlite/connection.h"
+#include "smartsqlite/sqlite3.h"
+#include "smartsqlite/statement.h"
+#include "smartsqlite/util.h"
+
+namespace SmartSqlite {
+
+namespace {
+
+void resetSilently(Statement &stmt)
+{
+    try
+    {
+        stmt.reset();
+    }
+    catch (...)
+    {
+        // reset() reports the error of the failed step again; it is already
+        // being propagated
+    }
+}
+
+void run(Statement &stmt, const RowCallback &callback)
+{
+    try
+    {
+        for (auto iter = stmt.begin(); iter != stmt.end(); ++iter)
+        {
+            if (callback) callback(*iter);
+        }
+    }
+    catch (...)
+    {
+        resetSilently(stmt);
+        throw;
+    }
+    stmt.reset();
+}
+
+}
+
+struct Script::Impl
+{
+    sqlite3 *conn = nullptr;
+    std::string sql;
+    std::size_t compiledUpTo = 0;
+    std::vector<Statement> statements;
+};
+
+Script::Script(sqlite3 *conn, const std::string &sql)
+    : impl(new Impl)
+{
+    impl->conn = conn;
+    impl->sql = sql;
+}
+
+Script::Script(Script &&other)
+    : impl(std::move(other.impl))
+{
+}
+
+Script &Script::operator=(Script &&rhs)
+{
+    std::swap(impl, rhs.impl);
+    return *this;
+}
+
+Script::~Script()
+{
+}
+
+void Script::exec()
+{
+    exec(RowCallback());
+}
+
+void Script::exec(const RowCallback &callback)
+{
+    for (std::size_t i = 0; ; ++i)
+    {
+        if (i == impl->statements.size() && !compileNext()) break;
+        run(impl->statements[i], callback);
+    }
+}
+
+std::size_t Script::compiledStatements() const
+{
+    // moved-from
+    if (!impl) return 0;
+
+    return impl->statements.size();
+}
+
+bool Script::compileNext()
+{
+    while (impl->compiledUpTo < impl->sql.size())
+    {
+        auto begin = impl->sql.c_str() + impl->compiledUpTo;
+
+        // see Connection::prepare() on why the terminating null is included
+        auto sqlSize = impl->sql.size() - impl->compiledUpTo + 1;
+        assert(sqlSize <= std::numeric_limits<int>::max());
+        auto sqlSizeInt = static_cast<int>(sqlSize);
+
+        sqlite3_stmt *stmtPtr = nullptr;
+        const char *tail = nullptr;
+        int result = sqlite3_prepare_v3(
+                    impl->conn, begin, sqlSizeInt, PreparePersistent, &stmtPtr, &tail);
+        if (result != SQLITE_OK)
+        {
+            CHECK_RESULT_MSG(result, std::string(sqlite3_errmsg(impl->conn)) + "\nSQL: " + begin);
+        }
+
+        impl->compiledUpTo = tail
+                ? static_cast<std::size_t>(tail - impl->sql.c_str())
+                : impl->sql.size();
+
+        // whitespace and comments don't yield a statement
+        if (stmtPtr)
+        {
+            impl->statements.emplace_back(impl->conn, stmtPtr);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
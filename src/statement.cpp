@@ -11,14 +11,186 @@
 
 #include "smartsqlite/exceptions.h"
 #include "smartsqlite/sqlite3.h"
+#include "smartsqlite/statementcache.h"
+#include "statementmetadata.h"
+
+#ifndef SMARTSQLITE_CHECK_BORROWED_BINDINGS
+#ifdef NDEBUG
+#define SMARTSQLITE_CHECK_BORROWED_BINDINGS 0
+#else
+#define SMARTSQLITE_CHECK_BORROWED_BINDINGS 1
+#endif
+#endif
 
 namespace SmartSqlite {
 
+namespace {
+
+const StatementMetadata::Column &getColumn(StatementMetadata &metadata, sqlite3_stmt *stmt, int pos)
+{
+    const auto &columns = metadata.columns(stmt);
+    if (pos < 0 || static_cast<std::size_t>(pos) >= columns.size())
+    {
+        throw ColumnUnknown(pos);
+    }
+    return columns[static_cast<std::size_t>(pos)];
+}
+
+}
+
 struct Statement::Impl
 {
     sqlite3 *conn = nullptr;
     sqlite3_stmt *stmt = nullptr;
     bool alreadyExecuted = false;
+    // set by fetchColumns() when the last row has been fetched
+    bool resultsDone = false;
+    std::shared_ptr<StatementCache> cache;
+    std::shared_ptr<StatementMetadata> metadata;
+
+    // sqlite3_changes() keeps the count of the last INSERT, UPDATE or DELETE,
+    // so it is only meaningful if this execution changed rows
+    int changesSince(int totalChangesBefore) const
+    {
+        if (sqlite3_total_changes(conn) == totalChangesBefore) return 0;
+        return sqlite3_changes(conn);
+    }
+
+    StatementMetadata &getMetadata()
+    {
+        if (!metadata) metadata = std::make_shared<StatementMetadata>();
+        return *metadata;
+    }
+
+    // Values moved into the statement by the owning binders, indexed by
+    // position. The vector is sized to the parameter count once, so the bound
+    // data never moves and there is one allocation per statement.
+    struct OwnedBinding
+    {
+        std::string text;
+        std::vector<unsigned char> blob;
+    };
+    std::vector<OwnedBinding> ownedBindings;
+
+    // nullptr if pos is out of range
+    OwnedBinding *ownedBindingSlot(int pos)
+    {
+        if (ownedBindings.empty())
+        {
+            ownedBindings.resize(static_cast<std::size_t>(sqlite3_bind_parameter_count(stmt)));
+        }
+        if (pos < 0 || static_cast<std::size_t>(pos) >= ownedBindings.size()) return nullptr;
+        return &ownedBindings[static_cast<std::size_t>(pos)];
+    }
+
+    static void release(OwnedBinding &binding)
+    {
+        std::string().swap(binding.text);
+        std::vector<unsigned char>().swap(binding.blob);
+    }
+
+    // called when pos has been bound to a value that isn't owned
+    void releaseOwnedBinding(int pos)
+    {
+        if (pos < 0 || static_cast<std::size_t>(pos) >= ownedBindings.size()) return;
+        release(ownedBindings[static_cast<std::size_t>(pos)]);
+    }
+
+    void releaseOwnedBindings()
+    {
+        for (auto &binding : ownedBindings) release(binding);
+    }
+
+#if SMARTSQLITE_CHECK_BORROWED_BINDINGS
+    struct BorrowedBinding
+    {
+        int pos;
+        const void *data;
+        // bytes, or elements for text arrays
+        std::size_t size;
+        bool textArray;
+        std::uint64_t checksum;
+    };
+    std::vector<BorrowedBinding> borrowedBindings;
+
+    static std::uint64_t checksum(
+            const void *data, std::size_t size,
+            std::uint64_t hash = 14695981039346656037ULL)
+    {
+        // FNV-1a
+        auto bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    static std::uint64_t checksum(const BorrowedBinding &binding)
+    {
+        if (!binding.textArray) return checksum(binding.data, binding.size);
+
+        auto strings = static_cast<const std::string*>(binding.data);
+        std::uint64_t hash = checksum(nullptr, 0);
+        for (std::size_t i = 0; i < binding.size; ++i)
+        {
+            // the terminating null separates the elements
+            hash = checksum(strings[i].c_str(), strings[i].size() + 1, hash);
+        }
+        return hash;
+    }
+#endif
+
+    void recordBorrowedBinding(int pos, const void *data, std::size_t size, bool textArray = false)
+    {
+        releaseOwnedBinding(pos);
+#if SMARTSQLITE_CHECK_BORROWED_BINDINGS
+        forgetBorrowedBinding(pos);
+        BorrowedBinding binding{pos, data, size, textArray, 0};
+        binding.checksum = checksum(binding);
+        borrowedBindings.push_back(binding);
+#else
+        (void)pos;
+        (void)data;
+        (void)size;
+        (void)textArray;
+#endif
+    }
+
+    void forgetBorrowedBinding(int pos)
+    {
+#if SMARTSQLITE_CHECK_BORROWED_BINDINGS
+        for (auto iter = borrowedBindings.begin(); iter != borrowedBindings.end(); ++iter)
+        {
+            if (iter->pos == pos)
+            {
+                borrowedBindings.erase(iter);
+                return;
+            }
+        }
+#else
+        (void)pos;
+#endif
+    }
+
+    void checkBorrowedBindings(bool forget)
+    {
+#if SMARTSQLITE_CHECK_BORROWED_BINDINGS
+        // clear() instead of dropping the vector keeps its capacity
+        for (const auto &binding : borrowedBindings)
+        {
+            if (checksum(binding) != binding.checksum)
+            {
+                int pos = binding.pos;
+                borrowedBindings.clear();
+                throw BorrowedBindingModified(pos, sqlite3_sql(stmt));
+            }
+        }
+        if (forget) borrowedBindings.clear();
+#else
+        (void)forget;
+#endif
+    }
 };
 
 Statement::Statement(sqlite3 *conn, sqlite3_stmt *stmt)
@@ -28,10 +200,20 @@ Statement::Statement(sqlite3 *conn, sqlite3_stmt *stmt)
     impl->stmt = stmt;
 }
 
+Statement::Statement(
+        sqlite3 *conn,
+        sqlite3_stmt *stmt,
+        std::shared_ptr<StatementCache> cache,
+        std::shared_ptr<StatementMetadata> metadata)
+    : Statement(conn, stmt)
+{
+    impl->cache = std::move(cache);
+    impl->metadata = std::move(metadata);
+}
+
 Statement::Statement(Statement &&other)
-    : impl(new Impl)
+    : impl(std::move(other.impl))
 {
-    std::swap(impl, other.impl);
 }
 
 Statement &Statement::operator=(Statement &&rhs)
@@ -42,12 +224,93 @@ Statement &Statement::operator=(Statement &&rhs)
 
 Statement::~Statement()
 {
-    sqlite3_finalize(impl->stmt);
+    // moved-from
+    if (!impl) return;
+
+    if (impl->metadata) impl->metadata->invalidateRows();
+    if (impl->cache)
+    {
+        impl->cache->release(impl->stmt, std::move(impl->metadata));
+    }
+    else
+    {
+        sqlite3_finalize(impl->stmt);
+    }
+}
+
+Statement &Statement::bind(int pos, const StringView &value)
+{
+    CHECK_RESULT(bindValue(pos, value));
+    return *this;
+}
+
+Statement &Statement::bind(int pos, const BlobView &value)
+{
+    CHECK_RESULT(bindValue(pos, value));
+    return *this;
+}
+
+Statement &Statement::bind(int pos, const std::vector<std::int64_t> &values)
+{
+    CHECK_RESULT(bindValue(pos, values));
+    return *this;
+}
+
+Statement &Statement::bind(int pos, const std::vector<double> &values)
+{
+    CHECK_RESULT(bindValue(pos, values));
+    return *this;
+}
+
+Statement &Statement::bind(int pos, const std::vector<std::string> &values)
+{
+    CHECK_RESULT(bindValue(pos, values));
+    return *this;
+}
+
+Statement &Statement::bind(int pos, std::string &&value)
+{
+    CHECK_RESULT(bindValue(pos, std::move(value)));
+    return *this;
+}
+
+Statement &Statement::bind(int pos, std::vector<unsigned char> &&value)
+{
+    CHECK_RESULT(bindValue(pos, std::move(value)));
+    return *this;
+}
+
+Statement &Statement::bind(int pos, std::vector<std::int64_t> &&values)
+{
+    CHECK_RESULT(bindValue(pos, std::move(values)));
+    return *this;
+}
+
+Statement &Statement::bind(int pos, std::vector<double> &&values)
+{
+    CHECK_RESULT(bindValue(pos, std::move(values)));
+    return *this;
+}
+
+Statement &Statement::bind(int pos, std::vector<std::string> &&values)
+{
+    CHECK_RESULT(bindValue(pos, std::move(values)));
+    return *this;
+}
+
+Statement &Statement::bind(const char *name, std::string &&value)
+{
+    return bind(getParameterPos(name), std::move(value));
+}
+
+Statement &Statement::bind(const char *name, std::vector<unsigned char> &&value)
+{
+    return bind(getParameterPos(name), std::move(value));
 }
 
 Statement &Statement::bindRawBlob(int pos, void *value, std::size_t size)
 {
-    CHECK_RESULT(NativeBinder::bindBlob(statementHandle(), pos, value, size));
+    CHECK_RESULT(boundCopy(pos, NativeBinder::bindBlob(statementHandle(), pos, value, size)));
     return *this;
 }
 
@@ -58,7 +321,7 @@ Statement &Statement::bindRawBlob(const char *name, void *value, std::size_t siz
 
 Statement &Statement::bindNull(int pos)
 {
-    CHECK_RESULT_CONN(sqlite3_bind_null(impl->stmt, pos + 1), impl->conn);
+    CHECK_RESULT_CONN(bindNullValue(pos), impl->conn);
     return *this;
 }
 
@@ -74,15 +337,124 @@ bool Statement::hasResults()
 
 RowIterator Statement::begin()
 {
-    auto iter = RowIterator(impl->conn, impl->stmt, RowIterator::Done::False);
+    auto &metadata = impl->getMetadata();
+    auto iter = RowIterator(impl->conn, impl->stmt, RowIterator::Done::False, &metadata);
 
     if (impl->alreadyExecuted) throw Exception("Statement::begin() can only be called once, it's an InputIterator");
+    impl->checkBorrowedBindings(false);
 
     impl->alreadyExecuted = true;
     ++iter;
+    metadata.checkColumns(impl->stmt);
     return iter;
 }
 
+ColumnBatch Statement::fetchColumns(std::size_t batchSize)
+{
+    ColumnBatch batch;
+    fetchColumns(batch, batchSize);
+    return batch;
+}
+
+std::size_t Statement::fetchColumns(ColumnBatch &batch, std::size_t batchSize)
+{
+    bool firstStep = !impl->alreadyExecuted;
+    if (firstStep)
+    {
+        impl->checkBorrowedBindings(false);
+        impl->alreadyExecuted = true;
+        impl->resultsDone = false;
+    }
+    if (impl->metadata) impl->metadata->invalidateRows();
+
+    batch.clear();
+    while (batch.rows() < batchSize && !impl->resultsDone)
+    {
+        int result = sqlite3_step(impl->stmt);
+        if (firstStep)
+        {
+            impl->getMetadata().checkColumns(impl->stmt);
+            firstStep = false;
+        }
+
+        if (result == SQLITE_DONE)
+        {
+            impl->resultsDone = true;
+            break;
+        }
+        if (result != SQLITE_ROW) CHECK_RESULT_STMT(result, impl->conn, impl->stmt);
+
+        // the columns can't change during an execution
+        if (batch.rows() == 0 && !batch.hasColumns(impl->stmt)) batch.setColumns(impl->stmt);
+        batch.append(impl->stmt);
+    }
+
+    // an empty batch must not keep the columns of another statement either
+    if (batch.rows() == 0 && !batch.hasColumns(impl->stmt)) batch.setColumns(impl->stmt);
+    return batch.rows();
+}
+
+int Statement::tryStep()
+{
+    bool firstStep = !impl->alreadyExecuted;
+    if (firstStep)
+    {
+        impl->checkBorrowedBindings(false);
+        impl->alreadyExecuted = true;
+    }
+    if (impl->metadata) impl->metadata->invalidateRows();
+
+    int result = sqlite3_step(impl->stmt);
+    if (firstStep) impl->getMetadata().checkColumns(impl->stmt);
+    return result;
+}
+
+Row Statement::row()
+{
+    Row row(impl->stmt, &impl->getMetadata());
+    row.setColumns(sqlite3_data_count(impl->stmt));
+    return row;
+}
+
+int Statement::tryExecute()
+{
+    int result = tryStep();
+    tryReset();
+    return result == SQLITE_DONE ? SQLITE_OK : result;
+}
+
+int Statement::tryReset()
+{
+    impl->alreadyExecuted = false;
+    impl->resultsDone = false;
+    int result = sqlite3_reset(impl->stmt);
+    if (impl->metadata) impl->metadata->invalidateRows();
+    impl->checkBorrowedBindings(false);
+    return result;
+}
+
+const char *Statement::errorMessage() const
+{
+    return sqlite3_errmsg(impl->conn);
+}
+
+bool Statement::isReadOnly() const
+{
+    return sqlite3_stmt_readonly(impl->stmt) != 0;
+}
+
+ResultSet Statement::fetchAll()
+{
+    auto iter = begin();
+    auto storage = ResultSet::createStorage(impl->stmt);
+    for (; iter != end(); ++iter)
+    {
+        ResultSet::appendRow(*storage, impl->stmt);
+    }
+    reset();
+    return ResultSet(std::move(storage));
+}
+
 RowIterator Statement::end()
 {
     return RowIterator(impl->conn, impl->stmt, RowIterator::Done::True);
@@ -97,6 +469,26 @@ void Statement::execWithoutResult()
     }
 }
 
+int Statement::execute()
+{
+    int totalChangesBefore = sqlite3_total_changes(impl->conn);
+    try
+    {
+        execWithoutResult();
+    }
+    catch (...)
+    {
+        // make the statement usable for the next execution
+        impl->alreadyExecuted = false;
+        sqlite3_reset(impl->stmt);
+        if (impl->metadata) impl->metadata->invalidateRows();
+        throw;
+    }
+    int changes = impl->changesSince(totalChangesBefore);
+    reset();
+    return changes;
+}
+
 Row Statement::execWithSingleResult()
 {
     auto first = begin();
@@ -110,13 +502,19 @@ Row Statement::execWithSingleResult()
 
 void Statement::clearBindings()
 {
+    impl->checkBorrowedBindings(true);
     CHECK_RESULT_CONN(sqlite3_clear_bindings(impl->stmt), impl->conn);
+    impl->releaseOwnedBindings();
 }
 
 void Statement::reset()
 {
     impl->alreadyExecuted = false;
-    CHECK_RESULT_CONN(sqlite3_reset(impl->stmt), impl->conn);
+    impl->resultsDone = false;
+    auto result = sqlite3_reset(impl->stmt);
+    if (impl->metadata) impl->metadata->invalidateRows();
+    impl->checkBorrowedBindings(false);
+    CHECK_RESULT_CONN(result, impl->conn);
 }
 
 sqlite3_stmt *Statement::statementHandle() const
@@ -126,9 +524,192 @@ sqlite3_stmt *Statement::statementHandle() const
 
 int Statement::getParameterPos(const char *name)
 {
-    int pos = sqlite3_bind_parameter_index(impl->stmt, name);
-    if (!pos) throw ParameterUnknown(name);
-    return pos - 1;
+    int pos = impl->getMetadata().parameterPos(impl->stmt, name);
+    if (pos < 0) throw ParameterUnknown(name);
+    return pos;
+}
+
+int Statement::columnCount()
+{
+    return static_cast<int>(impl->getMetadata().columns(impl->stmt).size());
+}
+
+const std::string &Statement::columnName(int pos)
+{
+    return getColumn(impl->getMetadata(), impl->stmt, pos).name;
+}
+
+const std::string &Statement::columnDeclaredType(int pos)
+{
+    return getColumn(impl->getMetadata(), impl->stmt, pos).declaredType;
+}
+
+Param Statement::parameter(const char *name)
+{
+    return Param(getParameterPos(name));
+}
+
+void Statement::checkParameterCount(std::size_t count) const
+{
+    int expected = sqlite3_bind_parameter_count(impl->stmt);
+    if (count != static_cast<std::size_t>(expected))
+    {
+        throw ParameterCountMismatch(expected, count, sqlite3_sql(impl->stmt));
+    }
+}
+
+void Statement::checkColumnCount(std::size_t count)
+{
+    int actual = columnCount();
+    if (count != static_cast<std::size_t>(actual))
+    {
+        impl->alreadyExecuted = false;
+        sqlite3_reset(impl->stmt);
+        if (impl->metadata) impl->metadata->invalidateRows();
+        throw ColumnCountMismatch(count, actual, sqlite3_sql(impl->stmt));
+    }
+}
+
+int Statement::executeRow()
+{
+    if (impl->metadata) impl->metadata->invalidateRows();
+    int totalChangesBefore = sqlite3_total_changes(impl->conn);
+    int result = sqlite3_step(impl->stmt);
+    if (result != SQLITE_DONE)
+    {
+        try
+        {
+            if (result == SQLITE_ROW) throw QueryReturnedRows(sqlite3_sql(impl->stmt));
+            CHECK_RESULT_STMT(result, impl->conn, impl->stmt);
+        }
+        catch (...)
+        {
+            sqlite3_reset(impl->stmt);
+            throw;
+        }
+    }
+
+    int changes = impl->changesSince(totalChangesBefore);
+    sqlite3_reset(impl->stmt);
+    impl->checkBorrowedBindings(false);
+    return changes;
+}
+
+bool Statement::beginImplicitTransaction()
+{
+    // don't interfere with transactions of the caller
+    if (!sqlite3_get_autocommit(impl->conn)) return false;
+
+    CHECK_RESULT_CONN(sqlite3_exec(impl->conn, "BEGIN TRANSACTION", nullptr, nullptr, nullptr),
+                      impl->conn);
+    return true;
+}
+
+void Statement::commitImplicitTransaction()
+{
+    CHECK_RESULT_CONN(sqlite3_exec(impl->conn, "COMMIT TRANSACTION", nullptr, nullptr, nullptr),
+                      impl->conn);
+}
+
+void Statement::rollbackImplicitTransaction()
+{
+    // errors are ignored, the original error is being propagated
+    sqlite3_exec(impl->conn, "ROLLBACK TRANSACTION", nullptr, nullptr, nullptr);
+}
+
+int Statement::bindValue(int pos, const StringView &value)
+{
+    int result = NativeBinder::bindStaticString(impl->stmt, pos, value.data(), value.size());
+    if (result == SQLITE_OK) impl->recordBorrowedBinding(pos, value.data(), value.size());
+    return result;
+}
+
+int Statement::bindValue(int pos, const BlobView &value)
+{
+    int result = NativeBinder::bindStaticBlob(impl->stmt, pos, value.data(), value.size());
+    if (result == SQLITE_OK) impl->recordBorrowedBinding(pos, value.data(), value.size());
+    return result;
+}
+
+int Statement::bindValue(int pos, const std::vector<std::int64_t> &values)
+{
+    int result = NativeBinder::bindInt64Array(impl->stmt, pos, values.data(), values.size());
+    if (result == SQLITE_OK)
+    {
+        impl->recordBorrowedBinding(pos, values.data(), values.size() * sizeof(values[0]));
+    }
+    return result;
+}
+
+int Statement::bindValue(int pos, const std::vector<double> &values)
+{
+    int result = NativeBinder::bindDoubleArray(impl->stmt, pos, values.data(), values.size());
+    if (result == SQLITE_OK)
+    {
+        impl->recordBorrowedBinding(pos, values.data(), values.size() * sizeof(values[0]));
+    }
+    return result;
+}
+
+int Statement::bindValue(int pos, const std::vector<std::string> &values)
+{
+    int result = NativeBinder::bindTextArray(impl->stmt, pos, values.data(), values.size());
+    if (result == SQLITE_OK) impl->recordBorrowedBinding(pos, values.data(), values.size(), true);
+    return result;
+}
+
+int Statement::bindValue(int pos, std::string &&value)
+{
+    auto slot = impl->ownedBindingSlot(pos);
+    // let SQLite report the invalid position
+    if (!slot) return sqlite3_bind_null(impl->stmt, pos + 1);
+
+    slot->text = std::move(value);
+    std::vector<unsigned char>().swap(slot->blob);
+    impl->forgetBorrowedBinding(pos);
+    return NativeBinder::bindStaticString(impl->stmt, pos, slot->text.data(), slot->text.size());
+}
+
+int Statement::bindValue(int pos, std::vector<unsigned char> &&value)
+{
+    auto slot = impl->ownedBindingSlot(pos);
+    // let SQLite report the invalid position
+    if (!slot) return sqlite3_bind_null(impl->stmt, pos + 1);
+
+    slot->blob = std::move(value);
+    std::string().swap(slot->text);
+    impl->forgetBorrowedBinding(pos);
+    return NativeBinder::bindStaticBlob(impl->stmt, pos, slot->blob.data(), slot->blob.size());
+}
+
+int Statement::bindValue(int pos, std::vector<std::int64_t> &&values)
+{
+    return boundCopy(pos, NativeBinder::bindInt64Array(impl->stmt, pos, std::move(values)));
+}
+
+int Statement::bindValue(int pos, std::vector<double> &&values)
+{
+    return boundCopy(pos, NativeBinder::bindDoubleArray(impl->stmt, pos, std::move(values)));
+}
+
+int Statement::bindValue(int pos, std::vector<std::string> &&values)
+{
+    return boundCopy(pos, NativeBinder::bindTextArray(impl->stmt, pos, std::move(values)));
+}
+
+int Statement::bindNullValue(int pos)
+{
+    return boundCopy(pos, sqlite3_bind_null(impl->stmt, pos + 1));
+}
+
+int Statement::boundCopy(int pos, int result)
+{
+    if (result == SQLITE_OK)
+    {
+        impl->forgetBorrowedBinding(pos);
+        impl->releaseOwnedBinding(pos);
+    }
+    return result;
 }
 
 }
@@ -0,0 +1,121 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include "smartsqlite/statementcache.h"
+
+#include "smartsqlite/sqlite3.h"
+#include "statementmetadata.h"
+
+namespace SmartSqlite {
+
+StatementCache::StatementCache(std::size_t capacity)
+    : capacity_(capacity)
+{
+}
+
+StatementCache::~StatementCache()
+{
+    clear();
+}
+
+sqlite3_stmt *StatementCache::acquire(
+        const std::string &sql,
+        std::shared_ptr<StatementMetadata> &metadata)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto indexIter = index_.find(sql);
+    if (indexIter == index_.end())
+    {
+        ++stats_.misses;
+        return nullptr;
+    }
+
+    ++stats_.hits;
+    auto stmt = indexIter->second->stmt;
+    metadata = std::move(indexIter->second->metadata);
+    lru_.erase(indexIter->second);
+    index_.erase(indexIter);
+    return stmt;
+}
+
+void StatementCache::release(sqlite3_stmt *stmt, std::shared_ptr<StatementMetadata> metadata)
+{
+    if (!stmt) return;
+
+    // don't care about errors from the last step, they have been reported
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (closed_ || capacity_ == 0)
+    {
+        sqlite3_finalize(stmt);
+        return;
+    }
+
+    std::string sql = sqlite3_sql(stmt);
+    if (index_.count(sql))
+    {
+        // an equivalent statement is already idle, keep only one of them
+        sqlite3_finalize(stmt);
+        return;
+    }
+
+    lru_.push_front(Entry{sql, stmt, std::move(metadata)});
+    index_.emplace(std::move(sql), lru_.begin());
+    evictOverCapacity();
+}
+
+void StatementCache::setCapacity(std::size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    evictOverCapacity();
+}
+
+StatementCacheStats StatementCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto result = stats_;
+    result.size = lru_.size();
+    result.capacity = capacity_;
+    return result;
+}
+
+void StatementCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &entry : lru_)
+    {
+        sqlite3_finalize(entry.stmt);
+    }
+    lru_.clear();
+    index_.clear();
+}
+
+void StatementCache::close()
+{
+    clear();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+}
+
+void StatementCache::evictOverCapacity()
+{
+    while (lru_.size() > capacity_)
+    {
+        auto &victim = lru_.back();
+        sqlite3_finalize(victim.stmt);
+        index_.erase(victim.sql);
+        lru_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+}
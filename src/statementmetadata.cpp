@@ -0,0 +1,119 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include "statementmetadata.h"
+
+#include <algorithm>
+
+#include "smartsqlite/sqlite3.h"
+
+namespace SmartSqlite {
+
+namespace {
+
+using NameIndex = std::vector<std::pair<std::string, int>>;
+
+int findName(const NameIndex &index, const char *name)
+{
+    auto iter = std::lower_bound(
+                index.begin(), index.end(), name,
+                [](const std::pair<std::string, int> &entry, const char *key) {
+                    return entry.first.compare(key) < 0;
+                });
+    if (iter == index.end() || iter->first.compare(name) != 0) return -1;
+    return iter->second;
+}
+
+}
+
+int StatementMetadata::parameterPos(sqlite3_stmt *stmt, const char *name)
+{
+    if (!m_parametersIndexed) indexParameters(stmt);
+    return findName(m_parameters, name);
+}
+
+const std::vector<StatementMetadata::Column> &StatementMetadata::columns(sqlite3_stmt *stmt)
+{
+    if (!m_columnsIndexed) indexColumns(stmt);
+    return m_columns;
+}
+
+int StatementMetadata::columnPos(sqlite3_stmt *stmt, const char *name)
+{
+    if (!m_columnsIndexed) indexColumns(stmt);
+    return findName(m_columnPositions, name);
+}
+
+void StatementMetadata::checkColumns(sqlite3_stmt *stmt)
+{
+    if (m_columnsIndexed &&
+            sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_REPREPARE, 0) != m_columnsReprepares)
+    {
+        m_columnsIndexed = false;
+    }
+}
+
+ViewGuard StatementMetadata::rowGuard()
+{
+#if SMARTSQLITE_CHECK_VIEWS
+    if (!m_rowGeneration) m_rowGeneration = std::make_shared<std::uint64_t>(0);
+    return ViewGuard(m_rowGeneration);
+#else
+    return ViewGuard();
+#endif
+}
+
+void StatementMetadata::indexParameters(sqlite3_stmt *stmt)
+{
+    int count = sqlite3_bind_parameter_count(stmt);
+    m_parameters.clear();
+    m_parameters.reserve(static_cast<std::size_t>(count));
+    for (int i = 1; i <= count; ++i)
+    {
+        // anonymous parameters don't have a name
+        auto name = sqlite3_bind_parameter_name(stmt, i);
+        if (name) m_parameters.emplace_back(name, i - 1);
+    }
+    std::sort(m_parameters.begin(), m_parameters.end());
+    m_parametersIndexed = true;
+}
+
+void StatementMetadata::indexColumns(sqlite3_stmt *stmt)
+{
+    int count = sqlite3_column_count(stmt);
+    m_columnsReprepares = sqlite3_stmt_status(stmt, SQLITE_STMTSTATUS_REPREPARE, 0);
+    m_columns.clear();
+    m_columns.reserve(static_cast<std::size_t>(count));
+    m_columnPositions.clear();
+    m_columnPositions.reserve(static_cast<std::size_t>(count));
+    for (int i = 0; i < count; ++i)
+    {
+        auto name = sqlite3_column_name(stmt, i);
+        auto declaredType = sqlite3_column_decltype(stmt, i);
+        m_columns.push_back(Column{
+                                name ? name : "",
+                                declaredType ? declaredType : ""});
+        m_columnPositions.emplace_back(m_columns.back().name, i);
+    }
+
+    // sort by name, then by descending position, and keep only the first
+    // entry of every name so that the last column of that name wins
+    std::sort(m_columnPositions.begin(), m_columnPositions.end(),
+              [](const std::pair<std::string, int> &lhs, const std::pair<std::string, int> &rhs) {
+                  int nameOrder = lhs.first.compare(rhs.first);
+                  if (nameOrder != 0) return nameOrder < 0;
+                  return lhs.second > rhs.second;
+              });
+    m_columnPositions.erase(
+                std::unique(m_columnPositions.begin(), m_columnPositions.end(),
+                            [](const std::pair<std::string, int> &lhs, const std::pair<std::string, int> &rhs) {
+                                return lhs.first == rhs.first;
+                            }),
+                m_columnPositions.end());
+    m_columnsIndexed = true;
+}
+
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "smartsqlite/views.h"
+
+#ifndef SMARTSQLITE_CHECK_VIEWS
+#ifdef NDEBUG
+#define SMARTSQLITE_CHECK_VIEWS 0
+#else
+#define SMARTSQLITE_CHECK_VIEWS 1
+#endif
+#endif
+
+struct sqlite3_stmt;
+
+namespace SmartSqlite {
+
+/**
+ * Information about a prepared statement that is computed once and then kept
+ * for the lifetime of the sqlite3_stmt, also while it is idle in the
+ * statement cache.
+ */
+struct StatementMetadata
+{
+    struct Column
+    {
+        std::string name;
+        // empty for expressions
+        std::string declaredType;
+    };
+
+    // Returns the 0-based position of the named parameter, or -1 if unknown.
+    int parameterPos(sqlite3_stmt *stmt, const char *name);
+
+    const std::vector<Column> &columns(sqlite3_stmt *stmt);
+    // Returns the position of the named column, or -1 if unknown. If multiple
+    // columns have the same name, the last one wins.
+    int columnPos(sqlite3_stmt *stmt, const char *name);
+    // Called once per execution. SQLite re-prepares statements after schema
+    // changes, which can change the names, order and number of the result
+    // columns of "SELECT *", so the index is rebuilt after every re-prepare.
+    void checkColumns(sqlite3_stmt *stmt);
+
+    // Guard for views into the current row. It is a no-op guard unless
+    // SMARTSQLITE_CHECK_VIEWS is enabled.
+    ViewGuard rowGuard();
+    // Must be called whenever the statement is stepped, reset or finalized.
+    void invalidateRows()
+    {
+#if SMARTSQLITE_CHECK_VIEWS
+        if (m_rowGeneration) ++*m_rowGeneration;
+#endif
+    }
+
+private:
+    void indexParameters(sqlite3_stmt *stmt);
+    void indexColumns(sqlite3_stmt *stmt);
+
+    bool m_parametersIndexed = false;
+    // sorted by name for binary search
+    std::vector<std::pair<std::string, int>> m_parameters;
+
+    bool m_columnsIndexed = false;
+    // SQLITE_STMTSTATUS_REPREPARE when the columns were indexed
+    int m_columnsReprepares = 0;
+    std::vector<Column> m_columns;
+    // sorted by name for binary search
+    std::vector<std::pair<std::string, int>> m_columnPositions;
+
+    // only allocated when the first view is guarded
+    std::shared_ptr<std::uint64_t> m_rowGeneration;
+};
+
+}
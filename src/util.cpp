@@ -11,14 +11,24 @@
 
 namespace SmartSqlite {
 
-void checkResult(const std::string &func, int result)
+namespace {
+
+bool isInterrupt(int result)
+{
+    return (result & 0xff) == SQLITE_INTERRUPT;
+}
+
+}
+
+void checkResult(const char *func, int result)
 {
     if (result == SQLITE_OK) return;
 
+    if (isInterrupt(result)) throw Interrupted(func, result);
     throw SqliteException(func, result);
 }
 
-void checkResult(const std::string &func, int result, sqlite3 *conn, sqlite3_stmt *stmt)
+void checkResult(const char *func, int result, sqlite3 *conn, sqlite3_stmt *stmt)
 {
     if (result == SQLITE_OK) return;
 
@@ -27,13 +37,15 @@ void checkResult(const std::string &func, int result, sqlite3 *conn, sqlite3_stm
     {
         errmsg += "\nSQL: " + std::string(sqlite3_sql(stmt));
     }
+    if (isInterrupt(result)) throw Interrupted(func, result, errmsg);
     throw SqliteException(func, result, errmsg);
 }
 
-void checkResult(const std::string &func, int result, const std::string &message)
+void checkResult(const char *func, int result, const std::string &message)
 {
     if (result == SQLITE_OK) return;
 
+    if (isInterrupt(result)) throw Interrupted(func, result, message);
     throw SqliteException(func, result, message);
 }
 
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include "smartsqlite/writequeue.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "smartsqlite/exceptions.h"
+
+namespace SmartSqlite {
+
+namespace {
+const std::string SAVEPOINT_NAME = "smartsqlite_write";
+}
+
+struct WriteQueue::Impl
+{
+    WriteQueueOptions options;
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::deque<std::unique_ptr<Write>> queue;
+    bool stopping = false;
+    WriteQueueStats stats;
+    std::thread writer;
+
+    void run(const std::string &connectionString, std::promise<void> opened)
+    {
+        std::unique_ptr<Connection> conn;
+        try
+        {
+            conn.reset(new Connection(connectionString));
+            if (options.setup) options.setup(*conn);
+        }
+        catch (...)
+        {
+            opened.set_exception(std::current_exception());
+            return;
+        }
+        opened.set_value();
+
+        std::vector<std::unique_ptr<Write>> batch;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;  // stopping and drained
+
+                // give other producers the chance to join the batch
+                auto deadline = std::chrono::steady_clock::now() + options.maxLatency;
+                wakeUp.wait_until(lock, deadline, [this] {
+                    return stopping || queue.size() >= options.maxBatchSize;
+                });
+
+                auto count = std::min(queue.size(), std::max<std::size_t>(options.maxBatchSize, 1));
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    batch.push_back(std::move(queue.front()));
+                    queue.pop_front();
+                }
+            }
+
+            runBatch(*conn, batch);
+            batch.clear();
+        }
+    }
+
+    void runBatch(Connection &conn, std::vector<std::unique_ptr<Write>> &batch)
+    {
+        std::vector<std::exception_ptr> failures(batch.size());
+        // first write of the current transaction
+        std::size_t transactionStart = 0;
+        auto beginFailure = begin(conn);
+
+        for (std::size_t i = 0; i < batch.size(); ++i)
+        {
+            if (beginFailure)
+            {
+                failures[i] = beginFailure;
+                continue;
+            }
+
+            runWrite(conn, *batch[i], failures[i]);
+            if (failures[i] && conn.isAutocommit())
+            {
+                // SQLite has rolled back the whole transaction, including
+                // the writes before this one; the remaining writes get a
+                // new transaction instead of running in autocommit mode
+                auto lost = std::make_exception_ptr(Exception(
+                        "Write was rolled back by a failing write of the same batch"));
+                for (std::size_t j = transactionStart; j < i; ++j)
+                {
+                    if (!failures[j]) failures[j] = lost;
+                }
+                transactionStart = i + 1;
+                if (transactionStart < batch.size()) beginFailure = begin(conn);
+            }
+        }
+
+        if (!beginFailure && transactionStart < batch.size())
+        {
+            try
+            {
+                conn.commitTransaction();
+            }
+            catch (...)
+            {
+                auto commitFailure = std::current_exception();
+                rollback(conn);
+                for (std::size_t j = transactionStart; j < batch.size(); ++j)
+                {
+                    if (!failures[j]) failures[j] = commitFailure;
+                }
+            }
+        }
+
+        // update the stats before any future becomes ready
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++stats.batches;
+            stats.writes += batch.size();
+            stats.failedWrites += std::count_if(
+                        failures.begin(), failures.end(),
+                        [](const std::exception_ptr &failure) { return failure != nullptr; });
+            stats.largestBatch = std::max(stats.largestBatch, batch.size());
+        }
+
+        for (std::size_t i = 0; i < batch.size(); ++i)
+        {
+            if (failures[i]) batch[i]->fail(failures[i]);
+            else batch[i]->succeed();
+        }
+    }
+
+    static std::exception_ptr begin(Connection &conn)
+    {
+        try
+        {
+            conn.beginTransaction(Immediate);
+        }
+        catch (...)
+        {
+            return std::current_exception();
+        }
+        return nullptr;
+    }
+
+    static void runWrite(Connection &conn, Write &write, std::exception_ptr &failure)
+    {
+        try
+        {
+            conn.savepoint(SAVEPOINT_NAME);
+        }
+        catch (...)
+        {
+            failure = std::current_exception();
+            return;
+        }
+
+        try
+        {
+            write.run(conn);
+            conn.releaseSavepoint(SAVEPOINT_NAME);
+        }
+        catch (...)
+        {
+            failure = std::current_exception();
+            try
+            {
+                conn.rollbackToSavepoint(SAVEPOINT_NAME);
+                conn.releaseSavepoint(SAVEPOINT_NAME);
+            }
+            catch (...)
+            {
+                // SQLite may have rolled back the whole transaction already,
+                // see runBatch()
+            }
+        }
+    }
+
+    static void rollback(Connection &conn)
+    {
+        try
+        {
+            conn.rollbackTransaction();
+        }
+        catch (...)
+        {
+            // the transaction may have been rolled back automatically
+        }
+    }
+};
+
+WriteQueue::WriteQueue(const std::string &connectionString, WriteQueueOptions options)
+    : impl(new Impl)
+{
+    impl->options = std::move(options);
+
+    std::promise<void> opened;
+    auto openedFuture = opened.get_future();
+    impl->writer = std::thread(&Impl::run, impl.get(), connectionString, std::move(opened));
+
+    try
+    {
+        openedFuture.get();
+    }
+    catch (...)
+    {
+        impl->writer.join();
+        throw;
+    }
+}
+
+WriteQueue::~WriteQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        impl->stopping = true;
+    }
+    impl->wakeUp.notify_one();
+    impl->writer.join();
+}
+
+WriteQueueStats WriteQueue::stats() const
+{
+    std::lock_guard<std::mutex> lock(impl->mutex);
+    return impl->stats;
+}
+
+void WriteQueue::enqueue(std::unique_ptr<Write> write)
+{
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(impl->mutex);
+        impl->queue.push_back(std::move(write));
+        wake = impl->queue.size() == 1
+                || impl->queue.size() >= impl->options.maxBatchSize;
+    }
+    // the writer only needs to wake up for the first write and when
+    // it can stop waiting for more
+    if (wake) impl->wakeUp.notify_one();
+}
+
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include <gmock/gmock.h>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "smartsqlite/connection.h"
+#include "smartsqlite/sqlite3.h"
+
+// This file replaces the global operator new, which is why it is built as a
+// separate test executable.
+//
+// Heap allocations of the hot path must be zero. SQLite itself may allocate
+// while stepping (e.g. for cursors if lookaside memory is disabled), so its
+// allocations are compared to the same operations done with the C API.
+
+namespace {
+
+std::size_t newCalls = 0;
+std::size_t sqliteMallocCalls = 0;
+sqlite3_mem_methods sqliteMethods;
+
+void *countingMalloc(int size)
+{
+    ++sqliteMallocCalls;
+    return sqliteMethods.xMalloc(size);
+}
+
+void *countingRealloc(void *ptr, int size)
+{
+    ++sqliteMallocCalls;
+    return sqliteMethods.xRealloc(ptr, size);
+}
+
+}
+
+void *operator new(std::size_t size)
+{
+    ++newCalls;
+    if (void *ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    ++newCalls;
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+using namespace testing;
+
+struct AllocationCount
+{
+    std::size_t heap;
+    std::size_t sqlite;
+};
+
+class Allocations : public Test
+{
+protected:
+    static void SetUpTestCase()
+    {
+        // route SQLite's allocations through the counting functions
+        sqlite3_shutdown();
+        sqlite3_config(SQLITE_CONFIG_GETMALLOC, &sqliteMethods);
+        sqlite3_mem_methods counting = sqliteMethods;
+        counting.xMalloc = countingMalloc;
+        counting.xRealloc = countingRealloc;
+        sqlite3_config(SQLITE_CONFIG_MALLOC, &counting);
+        sqlite3_initialize();
+    }
+
+    static void TearDownTestCase()
+    {
+        sqlite3_shutdown();
+        sqlite3_config(SQLITE_CONFIG_MALLOC, &sqliteMethods);
+        sqlite3_initialize();
+    }
+
+    Allocations()
+        : conn_(":memory:")
+    {
+        conn_.exec(SCHEMA);
+        sqlite3_open(":memory:", &raw_);
+        sqlite3_exec(raw_, SCHEMA, nullptr, nullptr, nullptr);
+    }
+
+    ~Allocations()
+    {
+        for (auto stmt : rawStatements_) sqlite3_finalize(stmt);
+        sqlite3_close(raw_);
+    }
+
+    sqlite3_stmt *prepareRaw(const char *sql)
+    {
+        sqlite3_stmt *stmt = nullptr;
+        sqlite3_prepare_v2(raw_, sql, -1, &stmt, nullptr);
+        rawStatements_.push_back(stmt);
+        return stmt;
+    }
+
+    // Runs iteration a few times to warm up caches, then counts the
+    // allocations of further iterations.
+    template <typename Iteration>
+    AllocationCount countAllocations(Iteration iteration)
+    {
+        for (int i = 0; i < 3; ++i) iteration();
+
+        newCalls = 0;
+        sqliteMallocCalls = 0;
+        for (int i = 0; i < 100; ++i) iteration();
+        return AllocationCount{newCalls, sqliteMallocCalls};
+    }
+
+    static const char *const SCHEMA;
+
+    SmartSqlite::Connection conn_;
+    sqlite3 *raw_ = nullptr;
+    std::vector<sqlite3_stmt *> rawStatements_;
+};
+
+const char *const Allocations::SCHEMA =
+        "CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT);"
+        "INSERT INTO items VALUES (1, 'first item'), (2, 'second item');";
+
+TEST_F(Allocations, selectByIntegerDoesNotAllocate)
+{
+    const char *sql = "SELECT id FROM items WHERE id = ?";
+    auto stmt = conn_.prepare(sql);
+    std::int64_t sum = 0;
+    auto count = countAllocations([&]() {
+        stmt.bind(0, 1);
+        sum += stmt.begin()->get<std::int64_t>(0);
+        stmt.reset();
+    });
+
+    auto raw = prepareRaw(sql);
+    auto baseline = countAllocations([&]() {
+        sqlite3_bind_int64(raw, 1, 1);
+        sqlite3_step(raw);
+        sqlite3_column_int64(raw, 0);
+        sqlite3_reset(raw);
+    });
+
+    EXPECT_THAT(count.heap, Eq(0u));
+    EXPECT_THAT(count.sqlite, Le(baseline.sqlite));
+    EXPECT_THAT(sum, Eq(103));
+}
+
+TEST_F(Allocations, selectTextIntoBufferDoesNotAllocate)
+{
+    const char *sql = "SELECT name FROM items WHERE name = ?";
+    auto stmt = conn_.prepare(sql);
+    std::string key = "second item";
+    std::string name;
+    auto count = countAllocations([&]() {
+        stmt.bind(0, SmartSqlite::StringView(key));
+        stmt.begin()->getInto(0, name);
+        stmt.reset();
+        stmt.clearBindings();
+    });
+
+    auto raw = prepareRaw(sql);
+    auto baseline = countAllocations([&]() {
+        sqlite3_bind_text(raw, 1, key.data(), static_cast<int>(key.size()), SQLITE_STATIC);
+        sqlite3_step(raw);
+        sqlite3_column_text(raw, 0);
+        sqlite3_reset(raw);
+        sqlite3_clear_bindings(raw);
+    });
+
+    EXPECT_THAT(count.heap, Eq(0u));
+    EXPECT_THAT(count.sqlite, Le(baseline.sqlite));
+    EXPECT_THAT(name, Eq(key));
+}
+
+TEST_F(Allocations, executeDoesNotAllocate)
+{
+    const char *sql = "UPDATE items SET name = ? WHERE id = ?";
+    auto stmt = conn_.prepare(sql);
+    std::string name = "renamed";
+    auto count = countAllocations([&]() {
+        stmt.bind(0, SmartSqlite::StringView(name));
+        stmt.bind(1, 1);
+        stmt.execute();
+        stmt.clearBindings();
+    });
+
+    auto raw = prepareRaw(sql);
+    auto baseline = countAllocations([&]() {
+        sqlite3_bind_text(raw, 1, name.data(), static_cast<int>(name.size()), SQLITE_STATIC);
+        sqlite3_bind_int64(raw, 2, 1);
+        sqlite3_step(raw);
+        sqlite3_reset(raw);
+        sqlite3_clear_bindings(raw);
+    });
+
+    EXPECT_THAT(count.heap, Eq(0u));
+    EXPECT_THAT(count.sqlite, Le(baseline.sqlite));
+}
+
+TEST_F(Allocations, tryApiDoesNotAllocate)
+{
+    const char *sql = "SELECT id, name FROM items";
+    auto stmt = conn_.prepare(sql);
+    std::size_t rows = 0;
+    auto count = countAllocations([&]() {
+        while (stmt.tryStep() == SQLITE_ROW)
+        {
+            rows += stmt.row().get<std::int64_t>(0) > 0;
+        }
+        stmt.tryReset();
+    });
+
+    auto raw = prepareRaw(sql);
+    auto baseline = countAllocations([&]() {
+        while (sqlite3_step(raw) == SQLITE_ROW)
+        {
+            sqlite3_column_int64(raw, 0);
+        }
+        sqlite3_reset(raw);
+    });
+
+    EXPECT_THAT(count.heap, Eq(0u));
+    EXPECT_THAT(count.sqlite, Le(baseline.sqlite));
+    EXPECT_THAT(rows, Eq(206u));
+}
+
+TEST_F(Allocations, movingStatementsDoesNotAllocate)
+{
+    auto stmt = conn_.prepare("SELECT id FROM items");
+    auto count = countAllocations([&]() {
+        SmartSqlite::Statement other(std::move(stmt));
+        stmt = std::move(other);
+    });
+    EXPECT_THAT(count.heap, Eq(0u));
+    EXPECT_THAT(count.sqlite, Eq(0u));
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include <gmock/gmock.h>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "smartsqlite/asyncconnection.h"
+#include "smartsqlite/exceptions.h"
+
+using namespace testing;
+
+class AsyncConnection : public Test
+{
+protected:
+    AsyncConnection()
+        : conn_(":memory:")
+    {
+        conn_.exec("CREATE TABLE events (id INTEGER PRIMARY KEY, name TEXT)").get();
+    }
+
+    std::int64_t countEvents()
+    {
+        return conn_.query("SELECT count(*) FROM events").get().at(0, 0).toInt64();
+    }
+
+    SmartSqlite::AsyncConnection conn_;
+};
+
+TEST_F(AsyncConnection, throwsIfConnectionCannotBeOpened)
+{
+    EXPECT_THROW(SmartSqlite::AsyncConnection("/nonexistent/directory/db.sqlite"),
+                 SmartSqlite::SqliteException);
+}
+
+TEST_F(AsyncConnection, runsWorkOnWorkerThread)
+{
+    auto workerId = conn_.submit([](SmartSqlite::Connection &) {
+        return std::this_thread::get_id();
+    }).get();
+    EXPECT_THAT(workerId, Ne(std::this_thread::get_id()));
+}
+
+TEST_F(AsyncConnection, canQuery)
+{
+    conn_.exec("INSERT INTO events (name) VALUES ('start'), ('stop')").get();
+    auto result = conn_.query("SELECT name FROM events ORDER BY id").get();
+    ASSERT_THAT(result.rows(), Eq(2u));
+    EXPECT_THAT(result.at(1, 0).text().toString(), Eq("stop"));
+}
+
+TEST_F(AsyncConnection, runsWorkInSubmissionOrder)
+{
+    std::vector<std::future<void>> inserts;
+    for (int i = 0; i < 100; ++i)
+    {
+        inserts.push_back(conn_.submit([i](SmartSqlite::Connection &conn) {
+            conn.prepareCached("INSERT INTO events (id) VALUES (?)").execute(i);
+        }));
+    }
+    for (auto &insert : inserts) insert.get();
+
+    auto ids = conn_.query("SELECT id FROM events ORDER BY rowid").get();
+    ASSERT_THAT(ids.rows(), Eq(100u));
+    for (std::size_t i = 0; i < ids.rows(); ++i)
+    {
+        EXPECT_THAT(ids.at(i, 0).toInt64(), Eq(static_cast<std::int64_t>(i)));
+    }
+}
+
+TEST_F(AsyncConnection, deliversExceptionsThroughFuture)
+{
+    auto result = conn_.exec("INSERT INTO missing_table VALUES (1)");
+    EXPECT_THROW(result.get(), SmartSqlite::SqliteException);
+
+    // the worker is still usable
+    EXPECT_THAT(countEvents(), Eq(0));
+}
+
+TEST_F(AsyncConnection, callsCompletionCallback)
+{
+    std::promise<std::exception_ptr> done;
+    conn_.post([](SmartSqlite::Connection &conn) {
+        conn.exec("INSERT INTO events (name) VALUES ('posted')");
+    }, [&done](std::exception_ptr exception) {
+        done.set_value(exception);
+    });
+    EXPECT_THAT(done.get_future().get() == nullptr, Eq(true));
+    EXPECT_THAT(countEvents(), Eq(1));
+}
+
+TEST_F(AsyncConnection, commitsTransaction)
+{
+    auto id = conn_.transaction([](SmartSqlite::Connection &conn) {
+        conn.exec("INSERT INTO events (name) VALUES ('committed')");
+        return conn.lastInsertRowId();
+    }).get();
+    EXPECT_THAT(id, Eq(1));
+    EXPECT_THAT(countEvents(), Eq(1));
+}
+
+TEST_F(AsyncConnection, rollsBackTransactionOnException)
+{
+    auto result = conn_.transaction([](SmartSqlite::Connection &conn) {
+        conn.exec("INSERT INTO events (name) VALUES ('rolled back')");
+        throw std::runtime_error("abort");
+    }, SmartSqlite::Immediate);
+    EXPECT_THROW(result.get(), std::runtime_error);
+    EXPECT_THAT(countEvents(), Eq(0));
+}
+
+TEST_F(AsyncConnection, destructorFinishesQueuedWork)
+{
+    std::future<void> last;
+    {
+        SmartSqlite::AsyncConnection conn(":memory:");
+        for (int i = 0; i < 10; ++i)
+        {
+            last = conn.exec("SELECT 1");
+        }
+    }
+    EXPECT_THAT(last.wait_for(std::chrono::seconds(0)), Eq(std::future_status::ready));
+}
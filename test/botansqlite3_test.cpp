@@ -5,6 +5,8 @@
  * in the root directory of this source tree for details.
  */
 #include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <memory>
 #include <string>
 
@@ -352,3 +354,38 @@ TEST_F(BotanSqlite3, attachWhenMainIsUnencrypted)
     deleteDb(dbFilename_);
     deleteDb(attachedFilename_);
 }
+
+TEST_F(BotanSqlite3, serializeExportsPlaintextOrStoredFile)
+{
+    connect();
+    setKey(SOME_KEY);
+    createTable();
+
+    auto plaintext = connection_->serialize();
+    auto stored = connection_->serialize("main", SmartSqlite::SerializeStored);
+    EXPECT_THAT(stored.size(), Eq(plaintext.size()));
+    EXPECT_THAT(stored, Ne(plaintext));
+    disconnect();
+
+    // the plaintext image can be read without the key
+    connect(":memory:");
+    connection_->deserialize(plaintext, true);
+    checkForTestData();
+    disconnect();
+
+    // the stored image is the encrypted file
+    deleteDb(dbFilename_);
+    {
+        std::ofstream file(dbFilename_, std::ios::binary);
+        file.write(reinterpret_cast<const char *>(stored.data()),
+                   static_cast<std::streamsize>(stored.size()));
+    }
+    connect();
+    EXPECT_THROW(checkForTestData(), SmartSqlite::SqliteException);
+    disconnect();
+    connect();
+    setKey(SOME_KEY);
+    checkForTestData();
+    disconnect();
+    deleteDb(dbFilename_);
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <gmock/gmock.h>
+
+#include "smartsqlite/checkpointscheduler.h"
+#include "smartsqlite/exceptions.h"
+
+using namespace testing;
+
+namespace {
+static int testCounter = 0;
+}
+
+class CheckpointScheduler : public Test
+{
+protected:
+    CheckpointScheduler()
+        : dbFilename_(tempDbName())
+        , conn_(dbFilename_)
+    {
+        conn_.exec("PRAGMA journal_mode = WAL");
+        conn_.exec("CREATE TABLE t (x INTEGER)");
+    }
+
+    ~CheckpointScheduler()
+    {
+        scheduler_.reset();
+        conn_ = SmartSqlite::Connection(":memory:");
+        for (auto suffix : {"", "-wal", "-shm"})
+        {
+            std::remove((dbFilename_ + suffix).c_str());
+        }
+    }
+
+    std::string tempDbName()
+    {
+        const auto now = std::chrono::system_clock::now();
+        const auto time = std::chrono::duration_cast<std::chrono::seconds>(
+                    now.time_since_epoch()).count();
+        return "smartsqlitetest_checkpoint_" + std::to_string(time)
+                + "_" + std::to_string(testCounter++) + ".sqlite";
+    }
+
+    void start(SmartSqlite::CheckpointPolicy policy)
+    {
+        scheduler_.reset(new SmartSqlite::CheckpointScheduler(dbFilename_, policy));
+        scheduler_->attach(conn_);
+    }
+
+    void insert(int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            conn_.exec("INSERT INTO t VALUES (randomblob(5000))");
+        }
+    }
+
+    // polls until condition holds or a generous timeout has passed
+    bool eventually(std::function<bool(const SmartSqlite::CheckpointStats &)> condition)
+    {
+        auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (std::chrono::steady_clock::now() < timeout)
+        {
+            if (condition(scheduler_->stats())) return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return false;
+    }
+
+    std::streamoff walFileSize()
+    {
+        std::ifstream wal(dbFilename_ + "-wal", std::ios::binary | std::ios::ate);
+        return wal.tellg();
+    }
+
+    std::string dbFilename_;
+    SmartSqlite::Connection conn_;
+    std::unique_ptr<SmartSqlite::CheckpointScheduler> scheduler_;
+};
+
+TEST_F(CheckpointScheduler, requiresWalMode)
+{
+    conn_.exec("PRAGMA journal_mode = DELETE");
+    EXPECT_THROW(SmartSqlite::CheckpointScheduler{dbFilename_}, SmartSqlite::Exception);
+}
+
+TEST_F(CheckpointScheduler, checkpointsPassivelyAfterEnoughFrames)
+{
+    SmartSqlite::CheckpointPolicy policy;
+    policy.passiveFrames = 5;
+    policy.idleTime = std::chrono::hours(1);
+    start(policy);
+
+    insert(10);
+    EXPECT_TRUE(eventually([](const SmartSqlite::CheckpointStats &stats) {
+        return stats.passive >= 1 && stats.framesCheckpointed >= 5;
+    }));
+
+    auto stats = scheduler_->stats();
+    EXPECT_THAT(stats.maxWalFrames, Ge(5));
+    EXPECT_THAT(stats.truncate, Eq(0u));
+}
+
+TEST_F(CheckpointScheduler, replacesAutomaticCheckpoints)
+{
+    SmartSqlite::CheckpointPolicy policy;
+    policy.passiveFrames = 1000000;
+    policy.restartFrames = 1000000;
+    policy.idleTime = std::chrono::hours(1);
+    start(policy);
+
+    // more than SQLite's automatic checkpoint threshold of 1000 frames
+    conn_.beginTransaction();
+    insert(1200);
+    conn_.commitTransaction();
+    insert(1);
+
+    auto stats = scheduler_->stats();
+    EXPECT_THAT(stats.walFrames, Gt(1000));
+    EXPECT_THAT(stats.passive + stats.restart + stats.truncate, Eq(0u));
+}
+
+TEST_F(CheckpointScheduler, truncatesWalWhenIdle)
+{
+    SmartSqlite::CheckpointPolicy policy;
+    policy.idleTime = std::chrono::milliseconds(20);
+    start(policy);
+
+    insert(3);
+    EXPECT_TRUE(eventually([](const SmartSqlite::CheckpointStats &stats) {
+        return stats.truncate == 1;
+    }));
+
+    auto stats = scheduler_->stats();
+    EXPECT_THAT(stats.walFrames, Eq(0));
+    EXPECT_THAT(stats.framesCheckpointed, Ge(3u));
+    EXPECT_THAT(walFileSize(), Eq(0));
+}
+
+TEST_F(CheckpointScheduler, reportsStarvationByReaders)
+{
+    SmartSqlite::CheckpointPolicy policy;
+    policy.passiveFrames = 1;
+    policy.restartFrames = 10;
+    policy.idleTime = std::chrono::hours(1);
+    policy.busyTimeoutMs = 0;
+    start(policy);
+
+    insert(1);
+    // a read transaction pins the current snapshot
+    SmartSqlite::Connection reader(dbFilename_);
+    reader.beginTransaction();
+    reader.prepare("SELECT count(*) FROM t").execWithSingleResult();
+
+    insert(20);
+    EXPECT_TRUE(eventually([](const SmartSqlite::CheckpointStats &stats) {
+        return stats.starved >= 1 && stats.restart >= 1;
+    }));
+
+    reader.rollbackTransaction();
+}
+
+TEST_F(CheckpointScheduler, detachRestoresAutomaticCheckpoints)
+{
+    SmartSqlite::CheckpointPolicy policy;
+    policy.passiveFrames = 1;
+    policy.idleTime = std::chrono::hours(1);
+    start(policy);
+    SmartSqlite::CheckpointScheduler::detach(conn_);
+
+    insert(10);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_THAT(scheduler_->stats().passive, Eq(0u));
+}
+
+TEST_F(CheckpointScheduler, backsOffAfterStarvedRestart)
+{
+    SmartSqlite::CheckpointPolicy policy;
+    // no checkpoint before the reader starts, so that it pins the WAL
+    policy.passiveFrames = 1000000;
+    policy.restartFrames = 20;
+    policy.restartBackoff = std::chrono::hours(1);
+    policy.idleTime = std::chrono::hours(1);
+    policy.busyTimeoutMs = 100;
+    start(policy);
+    // RESTART checkpoints hold the write lock while they wait for readers
+    conn_.setBusyTimeout(5000);
+
+    insert(1);
+    SmartSqlite::Connection reader(dbFilename_);
+    reader.beginTransaction();
+    reader.prepare("SELECT count(*) FROM t").execWithSingleResult();
+
+    // sustained writes for several times the busy timeout
+    int slowCommits = 0;
+    auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        auto start = std::chrono::steady_clock::now();
+        insert(1);
+        if (std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(50))
+        {
+            ++slowCommits;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    reader.rollbackTransaction();
+
+    // only the first RESTART may have blocked a commit
+    EXPECT_THAT(slowCommits, Le(1));
+    auto stats = scheduler_->stats();
+    EXPECT_THAT(stats.restart, Eq(1u));
+    EXPECT_THAT(stats.starved, Eq(1u));
+}
@@ -4,9 +4,15 @@
  * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
  * in the root directory of this source tree for details.
  */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <memory>
+#include <numeric>
 #include <gmock/gmock.h>
+#include <thread>
 #include <type_traits>
+#include <vector>
 
 #include "smartsqlite/connection.h"
 #include "smartsqlite/exceptions.h"
@@ -42,6 +48,59 @@ TEST(ConnectionConstructor, cannotCopy)
 }
 #endif
 
+TEST(ConnectionConstructor, readOnlyFlagPreventsCreatingDatabase)
+{
+    SmartSqlite::ConnectionOptions options;
+    options.flags = SmartSqlite::OpenReadOnly;
+    EXPECT_THROW(SmartSqlite::Connection("smartsqlitetest_missing.sqlite", options),
+                 SmartSqlite::SqliteException);
+}
+
+TEST(ConnectionConstructor, shouldFailWithUnknownVfs)
+{
+    SmartSqlite::ConnectionOptions options;
+    options.vfs = "no such vfs";
+    EXPECT_THROW(SmartSqlite::Connection(":memory:", options),
+                 SmartSqlite::SqliteException);
+}
+
+TEST(ConnectionConstructor, appliesOptions)
+{
+    SmartSqlite::ConnectionOptions options;
+    options.pageSize.setValue(8192);
+    options.journalMode = SmartSqlite::JournalModeOff;
+    options.synchronous = SmartSqlite::SynchronousOff;
+    options.cacheSize.setValue(-1234);
+    options.tempStore = SmartSqlite::TempStoreMemory;
+    auto conn = SmartSqlite::Connection(":memory:", options);
+
+    auto pragma = [&conn](const std::string &name) {
+        return conn.prepare("PRAGMA " + name).execWithSingleResult().get<std::string>(0);
+    };
+    EXPECT_THAT(pragma("page_size"), Eq("8192"));
+    EXPECT_THAT(pragma("journal_mode"), Eq("off"));
+    EXPECT_THAT(pragma("synchronous"), Eq("0"));
+    EXPECT_THAT(pragma("cache_size"), Eq("-1234"));
+    EXPECT_THAT(pragma("temp_store"), Eq("2"));
+}
+
+TEST(ConnectionConstructor, presetsApplyPragmasInOneScript)
+{
+    EXPECT_THAT(SmartSqlite::ConnectionOptions().pragmas(), Eq(""));
+    EXPECT_THAT(SmartSqlite::ConnectionOptions::readHeavyWal().pragmas(),
+                Eq("PRAGMA journal_mode = WAL;PRAGMA synchronous = NORMAL;"
+                   "PRAGMA cache_size = -65536;PRAGMA mmap_size = 268435456;"
+                   "PRAGMA temp_store = MEMORY;"));
+    EXPECT_THAT(SmartSqlite::ConnectionOptions::bulkLoad().pragmas(),
+                HasSubstr("PRAGMA synchronous = OFF;"));
+    EXPECT_THAT(SmartSqlite::ConnectionOptions::lowMemory().pragmas(),
+                HasSubstr("PRAGMA mmap_size = 0;"));
+
+    SmartSqlite::Connection(":memory:", SmartSqlite::ConnectionOptions::readHeavyWal());
+    SmartSqlite::Connection(":memory:", SmartSqlite::ConnectionOptions::bulkLoad());
+    SmartSqlite::Connection(":memory:", SmartSqlite::ConnectionOptions::lowMemory());
+}
+
 class Connection : public Test
 {
 protected:
@@ -147,3 +206,321 @@ TEST_F(Connection, canGetChanges)
               "UPDATE foo SET value = 23");
     EXPECT_THAT(conn.changes(), Eq(2));
 }
+
+TEST_F(Connection, prepareCachedReusesStatements)
+{
+    conn.prepareCached("PRAGMA user_version");
+    conn.prepareCached("PRAGMA user_version");
+    conn.prepareCached("PRAGMA application_id");
+
+    auto stats = conn.statementCacheStats();
+    EXPECT_THAT(stats.hits, Eq(1U));
+    EXPECT_THAT(stats.misses, Eq(2U));
+    EXPECT_THAT(stats.size, Eq(2U));
+}
+
+TEST_F(Connection, prepareCachedMissesWhileStatementIsInUse)
+{
+    auto stmt1 = conn.prepareCached("PRAGMA user_version");
+    auto stmt2 = conn.prepareCached("PRAGMA user_version");
+
+    auto stats = conn.statementCacheStats();
+    EXPECT_THAT(stats.hits, Eq(0U));
+    EXPECT_THAT(stats.misses, Eq(2U));
+}
+
+TEST_F(Connection, prepareCachedResetsAndClearsBindings)
+{
+    {
+        auto stmt = conn.prepareCached("SELECT ?");
+        stmt.bind(0, 42);
+        EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(42));
+    }
+    {
+        auto stmt = conn.prepareCached("SELECT ?");
+        EXPECT_THAT(stmt.execWithSingleResult().isNull(0), Eq(true));
+    }
+    EXPECT_THAT(conn.statementCacheStats().hits, Eq(1U));
+}
+
+TEST_F(Connection, statementCacheEvictsLeastRecentlyUsed)
+{
+    conn.setStatementCacheCapacity(1);
+    conn.prepareCached("PRAGMA user_version");
+    conn.prepareCached("PRAGMA application_id");
+    conn.prepareCached("PRAGMA user_version");
+
+    auto stats = conn.statementCacheStats();
+    EXPECT_THAT(stats.hits, Eq(0U));
+    EXPECT_THAT(stats.evictions, Eq(2U));
+    EXPECT_THAT(stats.size, Eq(1U));
+    EXPECT_THAT(stats.capacity, Eq(1U));
+}
+
+TEST_F(Connection, canClearStatementCache)
+{
+    conn.prepareCached("PRAGMA user_version");
+    conn.clearStatementCache();
+    EXPECT_THAT(conn.statementCacheStats().size, Eq(0U));
+}
+
+TEST(ConnectionStatementCache, cachedStatementCanOutliveConnection)
+{
+    std::unique_ptr<SmartSqlite::Statement> stmt;
+    {
+        SmartSqlite::Connection conn(":memory:");
+        stmt.reset(new SmartSqlite::Statement(conn.prepareCached("SELECT 1")));
+    }
+    EXPECT_THAT(stmt->execWithSingleResult().get<int>(0), Eq(1));
+}
+
+TEST_F(Connection, canPreparePersistentStatement)
+{
+    auto stmt = conn.prepare("SELECT 42", SmartSqlite::PreparePersistent);
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(42));
+}
+
+TEST_F(Connection, canPrepareWithCombinedFlags)
+{
+    conn.prepare("PRAGMA user_version",
+                 SmartSqlite::PreparePersistent | SmartSqlite::PrepareNoVtab);
+}
+
+TEST_F(Connection, prepareNoVtabRejectsVirtualTables)
+{
+    // carray() is an eponymous virtual table registered on every connection
+    const std::string sql = "SELECT value FROM carray(?)";
+    EXPECT_NO_THROW(conn.prepare(sql));
+    EXPECT_THROW(conn.prepare(sql, SmartSqlite::PrepareNoVtab),
+                 SmartSqlite::SqliteException);
+}
+
+namespace {
+const char *ENDLESS_QUERY =
+        "WITH RECURSIVE counter(x) AS (SELECT 1 UNION ALL SELECT x + 1 FROM counter) "
+        "SELECT count(*) FROM counter";
+
+bool stopAfterTenCalls(void *extraArg)
+{
+    auto calls = static_cast<int *>(extraArg);
+    return ++*calls < 10;
+}
+}
+
+TEST_F(Connection, expiredDeadlineInterruptsStatement)
+{
+    conn.setDeadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(20));
+    EXPECT_THROW(conn.exec(ENDLESS_QUERY), SmartSqlite::Interrupted);
+
+    conn.clearDeadline();
+    EXPECT_THAT(conn.prepare("SELECT 1").execWithSingleResult().get<int>(0), Eq(1));
+}
+
+TEST_F(Connection, progressCallbackCanInterruptStatement)
+{
+    int calls = 0;
+    conn.setProgressCallback(&stopAfterTenCalls, &calls, 100);
+    EXPECT_THROW(conn.exec(ENDLESS_QUERY), SmartSqlite::Interrupted);
+    EXPECT_THAT(calls, Eq(10));
+
+    conn.setProgressCallback(nullptr);
+    EXPECT_THAT(conn.prepare("SELECT 1").execWithSingleResult().get<int>(0), Eq(1));
+}
+
+TEST_F(Connection, canInterruptFromOtherThread)
+{
+    std::atomic<bool> done(false);
+    std::thread interrupter([this, &done] {
+        // interrupt() has no effect before the statement is running
+        while (!done)
+        {
+            conn.interrupt();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    auto stmt = conn.prepare(ENDLESS_QUERY);
+    EXPECT_THROW(stmt.execWithSingleResult(), SmartSqlite::Interrupted);
+    done = true;
+    interrupter.join();
+}
+
+namespace {
+bool giveUp(void *extraArg, int count)
+{
+    static_cast<std::vector<int> *>(extraArg)->push_back(count);
+    return count < 2;
+}
+}
+
+class ConnectionBusy : public Test
+{
+protected:
+    ConnectionBusy()
+        : dbFilename_("smartsqlitetest_busy_" + std::to_string(
+                          std::chrono::system_clock::now().time_since_epoch().count())
+                      + ".sqlite")
+        , holder_(dbFilename_)
+        , waiter_(dbFilename_)
+    {
+        holder_.exec("CREATE TABLE t (x INTEGER)");
+        holder_.beginTransaction(SmartSqlite::Exclusive);
+    }
+
+    ~ConnectionBusy()
+    {
+        std::remove(dbFilename_.c_str());
+    }
+
+    void insert()
+    {
+        waiter_.exec("INSERT INTO t VALUES (1)");
+    }
+
+    std::string dbFilename_;
+    SmartSqlite::Connection holder_;
+    SmartSqlite::Connection waiter_;
+};
+
+TEST_F(ConnectionBusy, backoffGivesUpAfterTimeout)
+{
+    SmartSqlite::BusyBackoff backoff;
+    backoff.timeout = std::chrono::milliseconds(50);
+    waiter_.setBusyBackoff(backoff);
+
+    EXPECT_THROW(insert(), SmartSqlite::SqliteException);
+
+    auto stats = waiter_.busyStats();
+    EXPECT_THAT(stats.waits, Eq(1u));
+    EXPECT_THAT(stats.timeouts, Eq(1u));
+    EXPECT_THAT(stats.invocations, Gt(1u));
+    EXPECT_THAT(stats.blockedTime, Ge(std::chrono::milliseconds(50)));
+    EXPECT_THAT(std::accumulate(stats.histogram.begin(), stats.histogram.end(), 0u), Eq(1u));
+    EXPECT_THAT(stats.histogram[0], Eq(0u));
+}
+
+TEST_F(ConnectionBusy, backoffWaitsForLock)
+{
+    waiter_.setBusyBackoff();
+    std::thread releaser([this] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        holder_.commitTransaction();
+    });
+    EXPECT_NO_THROW(insert());
+    releaser.join();
+
+    auto stats = waiter_.busyStats();
+    EXPECT_THAT(stats.waits, Eq(1u));
+    EXPECT_THAT(stats.timeouts, Eq(0u));
+    EXPECT_THAT(stats.blockedTime, Ge(std::chrono::milliseconds(15)));
+}
+
+TEST_F(ConnectionBusy, backoffRespectsDeadline)
+{
+    waiter_.setBusyBackoff();
+    auto start = std::chrono::steady_clock::now();
+    waiter_.setDeadline(start + std::chrono::milliseconds(30));
+
+    EXPECT_THROW(insert(), SmartSqlite::SqliteException);
+    EXPECT_THAT(std::chrono::steady_clock::now() - start, Lt(std::chrono::seconds(1)));
+    EXPECT_THAT(waiter_.busyStats().timeouts, Eq(1u));
+}
+
+TEST_F(ConnectionBusy, callsCustomBusyHandler)
+{
+    std::vector<int> counts;
+    waiter_.setBusyHandler(&giveUp, &counts);
+
+    EXPECT_THROW(insert(), SmartSqlite::SqliteException);
+    EXPECT_THAT(counts, ElementsAre(0, 1, 2));
+    EXPECT_THAT(waiter_.busyStats().invocations, Eq(3u));
+}
+
+TEST_F(Connection, canSerializeAndDeserialize)
+{
+    conn.exec("CREATE TABLE foo (id INTEGER PRIMARY KEY, name TEXT);"
+              "INSERT INTO foo VALUES (1, 'one'), (2, 'two')");
+    auto snapshot = conn.serialize();
+    EXPECT_THAT(snapshot.size() % 512, Eq(0u));
+
+    SmartSqlite::Connection copy(":memory:");
+    copy.deserialize(snapshot, false);
+    EXPECT_THAT(copy.prepare("SELECT name FROM foo WHERE id = 2")
+                .execWithSingleResult().get<std::string>(0), Eq("two"));
+
+    // the copy is independent and can grow
+    copy.exec("INSERT INTO foo (name) SELECT name FROM foo;"
+              "INSERT INTO foo (name) VALUES (randomblob(100000))");
+    EXPECT_THAT(conn.prepare("SELECT count(*) FROM foo")
+                .execWithSingleResult().get<int>(0), Eq(2));
+}
+
+TEST_F(Connection, readOnlyDeserializedDatabaseRejectsWrites)
+{
+    conn.exec("CREATE TABLE foo (id INTEGER PRIMARY KEY)");
+    SmartSqlite::Connection copy(":memory:");
+    copy.deserialize(conn.serialize(), true);
+
+    EXPECT_THAT(copy.prepare("SELECT count(*) FROM foo")
+                .execWithSingleResult().get<int>(0), Eq(0));
+    EXPECT_THROW(copy.exec("INSERT INTO foo VALUES (1)"), SmartSqlite::SqliteException);
+}
+
+TEST_F(Connection, canSerializeFileDatabase)
+{
+    const std::string filename = "smartsqlitetest_serialize.sqlite";
+    {
+        SmartSqlite::Connection file(filename);
+        file.exec("CREATE TABLE foo (x TEXT); INSERT INTO foo VALUES ('from file')");
+        auto snapshot = file.serialize();
+        auto pageSize = file.prepare("PRAGMA page_size").execWithSingleResult().get<int>(0);
+        auto pageCount = file.prepare("PRAGMA page_count").execWithSingleResult().get<int>(0);
+        EXPECT_THAT(snapshot.size(), Eq(static_cast<std::size_t>(pageSize * pageCount)));
+
+        conn.deserialize(snapshot, true);
+    }
+    std::remove(filename.c_str());
+
+    EXPECT_THAT(conn.prepare("SELECT x FROM foo")
+                .execWithSingleResult().get<std::string>(0), Eq("from file"));
+}
+
+TEST_F(Connection, canSerializeStoredDatabaseFile)
+{
+    const std::string filename = "smartsqlitetest_serialize_stored.sqlite";
+    {
+        SmartSqlite::Connection file(filename);
+        file.exec("CREATE TABLE foo (x TEXT); INSERT INTO foo VALUES ('from file')");
+        auto stored = file.serialize("main", SmartSqlite::SerializeStored);
+        EXPECT_THAT(stored, Eq(file.serialize()));
+
+        // the file doesn't contain uncommitted changes, the WAL may contain commits
+        file.beginTransaction();
+        EXPECT_THROW(file.serialize("main", SmartSqlite::SerializeStored),
+                     SmartSqlite::Exception);
+        file.rollbackTransaction();
+        file.exec("PRAGMA journal_mode = WAL");
+        EXPECT_THROW(file.serialize("main", SmartSqlite::SerializeStored),
+                     SmartSqlite::Exception);
+
+        conn.deserialize(stored, true);
+    }
+    for (auto suffix : {"", "-wal", "-shm"})
+    {
+        std::remove((filename + suffix).c_str());
+    }
+
+    EXPECT_THAT(conn.prepare("SELECT x FROM foo")
+                .execWithSingleResult().get<std::string>(0), Eq("from file"));
+}
+
+TEST_F(Connection, deserializingGarbageFailsOnFirstUse)
+{
+    conn.deserialize(std::vector<unsigned char>(4096, 0x42), true);
+    EXPECT_THROW(conn.exec("SELECT * FROM sqlite_master"), SmartSqlite::SqliteException);
+}
+
+TEST_F(Connection, serializeThrowsForUnknownSchema)
+{
+    EXPECT_THROW(conn.serialize("nonexistent"), SmartSqlite::SqliteException);
+}
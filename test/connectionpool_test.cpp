@@ -0,0 +1,160 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gmock/gmock.h>
+
+#include "smartsqlite/connectionpool.h"
+#include "smartsqlite/exceptions.h"
+
+using namespace testing;
+
+namespace {
+static int testCounter = 0;
+}
+
+class ConnectionPool : public Test
+{
+protected:
+    ConnectionPool()
+        : dbFilename_(tempDbName())
+    {
+        pool_.reset(new SmartSqlite::ConnectionPool(dbFilename_, 2));
+        pool_->writer()->exec("CREATE TABLE items (id INTEGER PRIMARY KEY, name TEXT)");
+    }
+
+    ~ConnectionPool()
+    {
+        pool_.reset();
+        for (auto suffix : {"", "-wal", "-shm"})
+        {
+            std::remove((dbFilename_ + suffix).c_str());
+        }
+    }
+
+    std::string tempDbName()
+    {
+        const auto now = std::chrono::system_clock::now();
+        const auto time = std::chrono::duration_cast<std::chrono::seconds>(
+                    now.time_since_epoch()).count();
+        return "smartsqlitetest_pool_" + std::to_string(time)
+                + "_" + std::to_string(testCounter++) + ".sqlite";
+    }
+
+    std::string dbFilename_;
+    std::unique_ptr<SmartSqlite::ConnectionPool> pool_;
+};
+
+TEST_F(ConnectionPool, routesReadOnlyStatementsToReaders)
+{
+    auto select = pool_->prepare("SELECT count(*) FROM items");
+    EXPECT_THAT(select.connection().isWriter(), Eq(false));
+
+    auto insert = pool_->prepare("INSERT INTO items (name) VALUES (?)");
+    EXPECT_THAT(insert.connection().isWriter(), Eq(true));
+}
+
+TEST_F(ConnectionPool, remembersRoutes)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        auto insert = pool_->prepare("INSERT INTO items (name) VALUES (?)");
+        insert->execute(std::string("item"));
+    }
+    // only the first preparation tried a reader
+    EXPECT_THAT(pool_->stats().readerCheckouts, Eq(1u));
+    EXPECT_THAT(pool_->reader()->prepare("SELECT count(*) FROM items")
+                .execWithSingleResult().get<int>(0), Eq(3));
+}
+
+TEST_F(ConnectionPool, usesStatementCompiledForRouting)
+{
+    auto before = pool_->stats();
+    {
+        auto select = pool_->prepare("SELECT count(*) FROM items");
+        EXPECT_THAT(select.connection().isWriter(), Eq(false));
+    }
+    auto after = pool_->stats();
+    EXPECT_THAT(after.readerCheckouts - before.readerCheckouts, Eq(1u));
+    EXPECT_THAT(after.writerCheckouts - before.writerCheckouts, Eq(0u));
+}
+
+TEST_F(ConnectionPool, routesWhileAllReadersAreInUse)
+{
+    auto select1 = pool_->prepare("SELECT count(*) FROM items");
+    auto select2 = pool_->prepare("SELECT count(*) FROM items");
+    EXPECT_THAT(select2.connection().isWriter(), Eq(false));
+
+    // must not wait for one of the readers to be returned
+    auto insert = pool_->prepare("INSERT INTO items (name) VALUES (?)");
+    EXPECT_THAT(insert.connection().isWriter(), Eq(true));
+    EXPECT_THAT(insert->execute(std::string("item")), Eq(1));
+}
+
+TEST_F(ConnectionPool, readersCannotWrite)
+{
+    EXPECT_THROW(pool_->reader()->exec("INSERT INTO items (name) VALUES ('x')"),
+                 SmartSqlite::SqliteException);
+}
+
+TEST_F(ConnectionPool, readersAreNotBlockedByWriter)
+{
+    auto writer = pool_->writer();
+    writer->beginTransaction(SmartSqlite::Immediate);
+    writer->exec("INSERT INTO items (name) VALUES ('uncommitted')");
+
+    auto select = pool_->prepare("SELECT count(*) FROM items");
+    EXPECT_THAT(select->execWithSingleResult().get<int>(0), Eq(0));
+
+    writer->commitTransaction();
+}
+
+TEST_F(ConnectionPool, waitsForReturnedConnection)
+{
+    auto writer = pool_->writer();
+    std::thread other([this] {
+        auto waitTime = pool_->writer().waitTime();
+        EXPECT_THAT(waitTime, Gt(std::chrono::nanoseconds::zero()));
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    { auto returned = std::move(writer); }
+    other.join();
+
+    auto stats = pool_->stats();
+    EXPECT_THAT(stats.writerCheckouts, Eq(3u));
+    EXPECT_THAT(stats.writerWaits, Eq(1u));
+    EXPECT_THAT(stats.maxWaitTime, Ge(std::chrono::milliseconds(10)));
+}
+
+TEST_F(ConnectionPool, canBeUsedFromMultipleThreads)
+{
+    pool_->writer()->exec("INSERT INTO items (name) VALUES ('a'), ('b')");
+
+    std::atomic<int> total(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([this, &total] {
+            for (int i = 0; i < 50; ++i)
+            {
+                auto select = pool_->prepare("SELECT count(*) FROM items");
+                total += select->execWithSingleResult().get<int>(0);
+            }
+        });
+    }
+    for (auto &thread : threads) thread.join();
+
+    EXPECT_THAT(total.load(), Eq(4 * 50 * 2));
+    // statements compiled for routing on a reader are used right away
+    EXPECT_THAT(pool_->stats().readerCheckouts, Eq(200u));
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include <gmock/gmock.h>
+#include <stdexcept>
+
+#include "smartsqlite/connection.h"
+#include "smartsqlite/resultset.h"
+
+using namespace testing;
+
+class ResultSet : public Test
+{
+protected:
+    ResultSet()
+        : conn_(":memory:")
+    {
+        conn_.exec("CREATE TABLE items (id INTEGER, price REAL, name TEXT, data BLOB)");
+        conn_.exec("INSERT INTO items VALUES (1, 1.5, 'short', x'0102')");
+        conn_.exec("INSERT INTO items VALUES (2, 2.5, 'a name that does not fit inline', NULL)");
+        conn_.exec("INSERT INTO items VALUES (3, NULL, '', x'')");
+    }
+
+    SmartSqlite::ResultSet fetchItems()
+    {
+        return conn_.prepare("SELECT id, price, name, data FROM items ORDER BY id")
+                .fetchAll();
+    }
+
+    SmartSqlite::Connection conn_;
+};
+
+TEST_F(ResultSet, isEmptyByDefault)
+{
+    SmartSqlite::ResultSet result;
+    EXPECT_THAT(result.empty(), Eq(true));
+    EXPECT_THAT(result.columnCount(), Eq(0u));
+    EXPECT_THAT(result.memoryUsage(), Eq(0u));
+}
+
+TEST_F(ResultSet, containsAllRows)
+{
+    auto result = fetchItems();
+    ASSERT_THAT(result.rows(), Eq(3u));
+    ASSERT_THAT(result.columnCount(), Eq(4u));
+    EXPECT_THAT(result.columnName(2), Eq("name"));
+
+    EXPECT_THAT(result.at(0, 0).type(), Eq(SmartSqlite::Value::Type::Integer));
+    EXPECT_THAT(result.at(0, 0).toInt64(), Eq(1));
+    EXPECT_THAT(result.at(1, 1).toDouble(), DoubleEq(2.5));
+    EXPECT_THAT(result.at(0, 2).text().toString(), Eq("short"));
+    EXPECT_THAT(result.at(1, 2).text().toString(), Eq("a name that does not fit inline"));
+    EXPECT_THAT(result.at(0, 3).blob().toVector(),
+                ElementsAre(static_cast<unsigned char>(1), static_cast<unsigned char>(2)));
+    EXPECT_THAT(result.at(1, 3).isNull(), Eq(true));
+    EXPECT_THAT(result.at(2, 1).isNull(), Eq(true));
+    EXPECT_THAT(result.at(2, 2).type(), Eq(SmartSqlite::Value::Type::Text));
+    EXPECT_THAT(result.at(2, 2).text().empty(), Eq(true));
+    EXPECT_THAT(result.at(2, 3).type(), Eq(SmartSqlite::Value::Type::Blob));
+}
+
+TEST_F(ResultSet, outlivesStatement)
+{
+    SmartSqlite::ResultSet result;
+    {
+        auto stmt = conn_.prepare("SELECT name FROM items WHERE id = 2");
+        result = stmt.fetchAll();
+    }
+    conn_.exec("DELETE FROM items");
+    EXPECT_THAT(result.at(0, 0).text().toString(), Eq("a name that does not fit inline"));
+}
+
+TEST_F(ResultSet, throwsOnInvalidPositions)
+{
+    auto result = fetchItems();
+    EXPECT_THROW(result.at(3, 0), std::out_of_range);
+    EXPECT_THROW(result.at(0, 4), std::out_of_range);
+    EXPECT_THROW(result.columnName(4), std::out_of_range);
+    EXPECT_THROW(result.slice(2, 2), std::out_of_range);
+}
+
+TEST_F(ResultSet, canBeSliced)
+{
+    auto slice = fetchItems().slice(1, 2);
+    ASSERT_THAT(slice.rows(), Eq(2u));
+    EXPECT_THAT(slice.at(0, 0).toInt64(), Eq(2));
+    EXPECT_THAT(slice.at(1, 0).toInt64(), Eq(3));
+    EXPECT_THAT(slice.at(0, 2).text().toString(), Eq("a name that does not fit inline"));
+
+    auto nested = slice.slice(1, 1);
+    EXPECT_THAT(nested.at(0, 0).toInt64(), Eq(3));
+}
+
+TEST_F(ResultSet, reportsMemoryUsage)
+{
+    auto result = fetchItems();
+    EXPECT_THAT(result.memoryUsage(),
+                Ge(result.rows() * result.columnCount() * sizeof(SmartSqlite::Value)));
+}
+
+TEST_F(ResultSet, statementCanBeReusedAfterFetchAll)
+{
+    auto stmt = conn_.prepare("SELECT name FROM items WHERE id = ?");
+    stmt.bind(0, 1);
+    EXPECT_THAT(stmt.fetchAll().at(0, 0).text().toString(), Eq("short"));
+    stmt.bind(0, 3);
+    EXPECT_THAT(stmt.fetchAll().rows(), Eq(1u));
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include <gmock/gmock.h>
+#include <type_traits>
+
+#include "smartsqlite/connection.h"
+#include "smartsqlite/exceptions.h"
+
+using namespace testing;
+
+class Script : public Test
+{
+protected:
+    int countRows(const std::string &table)
+    {
+        return conn_.prepare("SELECT count(*) FROM " + table)
+                .execWithSingleResult().get<int>(0);
+    }
+
+    SmartSqlite::Connection conn_ = SmartSqlite::Connection(":memory:");
+};
+
+TEST_F(Script, canMove)
+{
+    EXPECT_THAT((std::is_move_constructible<SmartSqlite::Script>::value),
+                Eq(true));
+    EXPECT_THAT((std::is_move_assignable<SmartSqlite::Script>::value),
+                Eq(true));
+}
+
+TEST_F(Script, compilesLazily)
+{
+    auto script = conn_.prepareScript("SELECT 1; SELECT 2;");
+    EXPECT_THAT(script.compiledStatements(), Eq(0U));
+    script.exec();
+    EXPECT_THAT(script.compiledStatements(), Eq(2U));
+}
+
+TEST_F(Script, canReferToTablesCreatedInScript)
+{
+    auto script = conn_.prepareScript(
+                "CREATE TABLE foo (id INT);"
+                "INSERT INTO foo VALUES (42);");
+    script.exec();
+    EXPECT_THAT(countRows("foo"), Eq(1));
+}
+
+TEST_F(Script, canBeRunRepeatedly)
+{
+    conn_.exec("CREATE TABLE foo (id INT)");
+    auto script = conn_.prepareScript(
+                "INSERT INTO foo VALUES (1);"
+                "  -- comment\n"
+                "INSERT INTO foo VALUES (2);\n");
+    script.exec();
+    script.exec();
+    script.exec();
+    EXPECT_THAT(script.compiledStatements(), Eq(2U));
+    EXPECT_THAT(countRows("foo"), Eq(6));
+}
+
+TEST_F(Script, invokesCallbackForAllRows)
+{
+    auto script = conn_.prepareScript(
+                "SELECT 1 UNION ALL SELECT 2;"
+                "SELECT 3;");
+    std::vector<int> values;
+    script.exec([&values](const SmartSqlite::Row &row) {
+        values.push_back(row.get<int>(0));
+    });
+    EXPECT_THAT(values, ElementsAre(1, 2, 3));
+}
+
+TEST_F(Script, canBeRunAgainAfterFailure)
+{
+    conn_.exec("CREATE TABLE foo (id INT UNIQUE)");
+    auto script = conn_.prepareScript("INSERT INTO foo VALUES (42)");
+    script.exec();
+    EXPECT_THROW(script.exec(), SmartSqlite::SqliteException);
+
+    conn_.exec("DELETE FROM foo");
+    script.exec();
+    EXPECT_THAT(countRows("foo"), Eq(1));
+}
+
+TEST_F(Script, throwsOnSyntaxError)
+{
+    auto script = conn_.prepareScript("SELECT 1; SELEC 2;");
+    EXPECT_THROW(script.exec(), SmartSqlite::SqliteException);
+}
+
+TEST_F(Script, connectionExecInvokesCallback)
+{
+    int sum = 0;
+    conn_.exec("SELECT 20 UNION ALL SELECT 22", [&sum](const SmartSqlite::Row &row) {
+        sum += row.get<int>(0);
+    });
+    EXPECT_THAT(sum, Eq(42));
+}
+
+TEST_F(Script, connectionExecBypassesStatementCache)
+{
+    conn_.exec("PRAGMA user_version = 42");
+    conn_.exec("PRAGMA user_version = 42");
+    conn_.prepareScript("PRAGMA user_version = 42").exec();
+
+    auto stats = conn_.statementCacheStats();
+    EXPECT_THAT(stats.hits, Eq(0U));
+    EXPECT_THAT(stats.misses, Eq(0U));
+    EXPECT_THAT(stats.size, Eq(0U));
+}
+
+TEST_F(Script, connectionExecCachesSingleStatements)
+{
+    conn_.exec("PRAGMA user_version = 42");
+    conn_.exec("PRAGMA user_version = 42");
+    conn_.exec("PRAGMA user_version = 42");
+
+    auto stats = conn_.execCacheStats();
+    EXPECT_THAT(stats.misses, Eq(1U));
+    EXPECT_THAT(stats.hits, Eq(2U));
+    EXPECT_THAT(stats.size, Eq(1U));
+}
+
+TEST_F(Script, connectionExecCachesOnlyTheLastOfMultipleStatements)
+{
+    conn_.exec("PRAGMA user_version = 1; PRAGMA user_version = 2");
+    conn_.exec("PRAGMA user_version = 1; PRAGMA user_version = 2");
+
+    // only the statement that ends the text is kept and found again
+    auto stats = conn_.execCacheStats();
+    EXPECT_THAT(stats.hits, Eq(1U));
+    EXPECT_THAT(stats.size, Eq(1U));
+}
+
+TEST_F(Script, connectionExecReportsErrorsAsExec)
+{
+    conn_.exec("CREATE TABLE foo (id INTEGER PRIMARY KEY)");
+    try
+    {
+        conn_.exec("INSERT INTO foo VALUES (1); INSERT INTO foo VALUES (1)");
+        FAIL() << "exec() didn't throw";
+    }
+    catch (const SmartSqlite::SqliteException &ex)
+    {
+        EXPECT_THAT(ex.what(), StartsWith("[exec] "));
+    }
+}
@@ -11,6 +11,7 @@
 #include "smartsqlite/connection.h"
 #include "smartsqlite/exceptions.h"
 #include "smartsqlite/nullable.h"
+#include "smartsqlite/sqlite3.h"
 
 using namespace testing;
 
@@ -416,6 +417,104 @@ TEST_F(Statement, canGetBlob)
                 Eq(exampleBlob()));
 }
 
+TEST_F(Statement, canGetStringView)
+{
+    SmartSqlite::Statement stmt = makeSelectAll();
+    auto view = stmt.begin()->get<SmartSqlite::StringView>(2);
+    EXPECT_THAT(view.toString(), Eq("6*7"));
+}
+
+TEST_F(Statement, canGetStringViewWithEmbeddedNul)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT CAST(x'610062' AS TEXT)");
+    auto view = stmt.execWithSingleResult().get<SmartSqlite::StringView>(0);
+    EXPECT_THAT(view.toString(), Eq(std::string("a\0b", 3)));
+}
+
+TEST_F(Statement, canGetBlobView)
+{
+    SmartSqlite::Statement stmt = makeSelectAll();
+    auto view = stmt.begin()->get<SmartSqlite::BlobView>(3);
+    EXPECT_THAT(view.toVector(), Eq(exampleBlob()));
+}
+
+TEST_F(Statement, getIntoReusesStringCapacity)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT c_text FROM all_types");
+    std::string value;
+    value.reserve(64);
+    auto buffer = value.data();
+
+    auto iter = stmt.begin();
+    iter->getInto(0, value);
+    EXPECT_THAT(value, Eq("6*7"));
+    EXPECT_THAT(value.data(), Eq(buffer));
+
+    ++iter;
+    iter->getInto("c_text", value);
+    EXPECT_THAT(value, Eq(""));
+    EXPECT_THAT(value.data(), Eq(buffer));
+}
+
+TEST_F(Statement, getIntoReusesBlobCapacity)
+{
+    SmartSqlite::Statement stmt = makeSelectAll();
+    std::vector<unsigned char> value;
+    value.reserve(64);
+    auto buffer = value.data();
+
+    stmt.begin()->getInto(3, value);
+    EXPECT_THAT(value, Eq(exampleBlob()));
+    EXPECT_THAT(value.data(), Eq(buffer));
+}
+
+TEST_F(Statement, canGetIntoNumbers)
+{
+    SmartSqlite::Statement stmt = makeSelectAll();
+    auto iter = stmt.begin();
+    int intValue = 0;
+    double doubleValue = 0;
+    iter->getInto(0, intValue);
+    iter->getInto("c_float", doubleValue);
+    EXPECT_THAT(intValue, Eq(42));
+    EXPECT_THAT(doubleValue, DoubleEq(2.0));
+}
+
+TEST_F(Statement, viewsOfNullAreEmpty)
+{
+    SmartSqlite::Statement stmt = makeSelectAllNull();
+    auto iter = stmt.begin();
+    EXPECT_THAT(iter->get<SmartSqlite::StringView>(2).empty(), Eq(true));
+    EXPECT_THAT(iter->get<SmartSqlite::BlobView>(3).empty(), Eq(true));
+    EXPECT_THAT(iter->get<std::string>(2), Eq(""));
+    EXPECT_THAT(static_cast<bool>(iter->getNullable<SmartSqlite::StringView>(2)), Eq(false));
+}
+
+#ifndef NDEBUG
+TEST_F(Statement, viewsAreInvalidatedByStepping)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT c_text, c_blob FROM all_types");
+    auto iter = stmt.begin();
+    auto text = iter->get<SmartSqlite::StringView>(0);
+    auto blob = iter->get<SmartSqlite::BlobView>(1);
+    EXPECT_THAT(text.isValid(), Eq(true));
+    EXPECT_THAT(blob.isValid(), Eq(true));
+
+    ++iter;
+    EXPECT_THAT(text.isValid(), Eq(false));
+    EXPECT_THAT(blob.isValid(), Eq(false));
+    EXPECT_THAT(iter->get<SmartSqlite::StringView>(0).isValid(), Eq(true));
+}
+
+TEST_F(Statement, viewsAreInvalidatedByReset)
+{
+    SmartSqlite::Statement stmt = makeSelectAll();
+    auto view = stmt.begin()->get<SmartSqlite::StringView>(2);
+    stmt.reset();
+    EXPECT_THAT(view.isValid(), Eq(false));
+}
+#endif
+
 TEST_F(Statement, canGetNullNullables)
 {
     SmartSqlite::Statement stmt = makeSelectAllNull();
@@ -494,3 +593,748 @@ TEST_F(Statement, execWithSingleResultExceptionContainsSql)
 
     EXPECT_THAT(what, HasSubstr("SELECT c_text FROM all_types WHERE c_int = 23"));
 }
+
+TEST_F(Statement, canBindBorrowedString)
+{
+    std::string value = "6*7";
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "SELECT c_int FROM all_types WHERE c_text = ?");
+    stmt.bind(0, SmartSqlite::StringView(value));
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(42));
+}
+
+TEST_F(Statement, canBindBorrowedStringWithoutNullTerminator)
+{
+    std::string value = "6*7*8";
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "SELECT c_int FROM all_types WHERE c_text = ?");
+    stmt.bind(0, SmartSqlite::StringView(value.data(), 3));
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(42));
+}
+
+TEST_F(Statement, canBindBorrowedBlob)
+{
+    auto value = exampleBlob();
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "SELECT c_int FROM all_types WHERE c_blob = ?");
+    stmt.bind(0, SmartSqlite::BlobView(value));
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(42));
+}
+
+TEST_F(Statement, canBindEmptyBorrowedBlob)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT length(?)");
+    stmt.bind(0, SmartSqlite::BlobView());
+    EXPECT_THAT(stmt.execWithSingleResult().getNullable<int>(0),
+                Eq(SmartSqlite::Nullable<int>(0)));
+}
+
+#ifndef NDEBUG
+TEST_F(Statement, detectsModifiedBorrowedBindingOnExecution)
+{
+    std::string value = "6*7";
+    SmartSqlite::Statement stmt = makeSelect();
+    stmt.bind(0, SmartSqlite::StringView(value));
+    value[0] = '7';
+    EXPECT_THROW(stmt.begin(), SmartSqlite::BorrowedBindingModified);
+}
+
+TEST_F(Statement, detectsModifiedBorrowedBindingOnReset)
+{
+    auto value = exampleBlob();
+    SmartSqlite::Statement stmt = makeSelect();
+    stmt.bind(0, SmartSqlite::BlobView(value));
+    stmt.execWithoutResult();
+    value[0] = 0;
+    EXPECT_THROW(stmt.reset(), SmartSqlite::BorrowedBindingModified);
+}
+
+TEST_F(Statement, detectsModifiedBorrowedBindingAfterReset)
+{
+    // reset() keeps the bindings, so the data is still in use
+    std::string value = "6*7";
+    SmartSqlite::Statement stmt = makeSelect();
+    stmt.bind(0, SmartSqlite::StringView(value));
+    stmt.execWithoutResult();
+    stmt.reset();
+    value[0] = '7';
+    EXPECT_THROW(stmt.execWithoutResult(), SmartSqlite::BorrowedBindingModified);
+}
+
+TEST_F(Statement, borrowedBindingMayBeModifiedAfterClearBindings)
+{
+    std::string value = "6*7";
+    SmartSqlite::Statement stmt = makeSelect();
+    stmt.bind(0, SmartSqlite::StringView(value));
+    stmt.execWithoutResult();
+    stmt.reset();
+    stmt.clearBindings();
+    value[0] = '7';
+    stmt.execWithoutResult();
+}
+
+TEST_F(Statement, borrowedBindingMayBeModifiedAfterRebindingInt)
+{
+    std::string value = "6*7";
+    SmartSqlite::Statement stmt = makeSelect();
+    stmt.bind(0, SmartSqlite::StringView(value));
+    stmt.bind(0, -1);
+    value[0] = '7';
+    stmt.execWithoutResult();
+}
+
+TEST_F(Statement, borrowedBindingMayBeModifiedAfterRebindingCopiedString)
+{
+    std::string value = "6*7";
+    const std::string copied = "6*7";
+    SmartSqlite::Statement stmt = makeSelect();
+    stmt.bind(0, SmartSqlite::StringView(value));
+    stmt.bind(0, copied);
+    value[0] = '7';
+    stmt.execWithoutResult();
+}
+
+TEST_F(Statement, borrowedBindingMayBeModifiedAfterRebindingWithBindAll)
+{
+    auto value = exampleBlob();
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT 1 WHERE ? IS NULL");
+    stmt.bind(0, SmartSqlite::BlobView(value));
+    stmt.bindAll(value);
+    value[0] = 0;
+    stmt.execWithoutResult();
+}
+#endif
+
+TEST_F(Statement, canBindMovedString)
+{
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "SELECT c_int FROM all_types WHERE c_text = ?");
+    stmt.bind(0, std::string("6*7"));
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(42));
+}
+
+TEST_F(Statement, canBindMovedBlob)
+{
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "SELECT c_int FROM all_types WHERE c_blob = ?");
+    stmt.bind(0, exampleBlob());
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(42));
+}
+
+TEST_F(Statement, canRebindMovedStringWithCopiedValue)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT ?");
+    stmt.bind(0, std::string(100, 'x'));
+    stmt.bind(0, 42);
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(42));
+    stmt.reset();
+
+    stmt.bind(0, exampleBlob());
+    stmt.bind(0, SmartSqlite::StringView("6*7"));
+    EXPECT_THAT(stmt.execWithSingleResult().get<std::string>(0), Eq("6*7"));
+}
+
+TEST_F(Statement, throwsOnMovedValueForInvalidPosition)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT ?");
+    EXPECT_THROW(stmt.bind(1, std::string("6*7")), SmartSqlite::SqliteException);
+    EXPECT_THROW(stmt.bind(-1, exampleBlob()), SmartSqlite::SqliteException);
+}
+
+TEST_F(Statement, canBindMovedValuesByName)
+{
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "SELECT c_int FROM all_types WHERE c_text = :text AND c_blob = :blob");
+    stmt.bind(":text", std::string("6*7"));
+    stmt.bind(":blob", exampleBlob());
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(42));
+}
+
+TEST_F(Statement, canRebindMovedValues)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT ?, ?");
+    stmt.bind(0, std::string("first"));
+    stmt.bind(1, std::string("a long string that doesn't fit into the small string buffer"));
+    stmt.bind(0, exampleBlob());
+    auto row = stmt.execWithSingleResult();
+    EXPECT_THAT(row.get<std::vector<unsigned char>>(0), Eq(exampleBlob()));
+    EXPECT_THAT(row.get<std::string>(1),
+                Eq("a long string that doesn't fit into the small string buffer"));
+}
+
+TEST_F(Statement, movedValuesAreReleasedByClearBindings)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT ?");
+    stmt.bind(0, std::string("Hello, world."));
+    stmt.clearBindings();
+    EXPECT_THAT(stmt.execWithSingleResult().isNull(0), Eq(true));
+}
+
+TEST_F(Statement, canBindAll)
+{
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "SELECT c_int FROM all_types "
+                "WHERE c_int = ? AND c_float = ? AND c_text = ? AND c_blob = ?");
+    stmt.bindAll(42, 2.0, std::string("6*7"), exampleBlob());
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(42));
+}
+
+TEST_F(Statement, canBindAllWithNullablesAndViews)
+{
+    std::string text = "6*7";
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT ?, ?, ?");
+    stmt.bindAll(SmartSqlite::Nullable<int>(), SmartSqlite::Nullable<int>(23),
+                 SmartSqlite::StringView(text));
+    auto row = stmt.execWithSingleResult();
+    EXPECT_THAT(row.isNull(0), Eq(true));
+    EXPECT_THAT(row.get<int>(1), Eq(23));
+    EXPECT_THAT(row.get<std::string>(2), Eq(text));
+}
+
+TEST_F(Statement, bindAllThrowsOnParameterCountMismatch)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT ?, ?");
+    EXPECT_THROW(stmt.bindAll(1), SmartSqlite::ParameterCountMismatch);
+    EXPECT_THROW(stmt.bindAll(1, 2, 3), SmartSqlite::ParameterCountMismatch);
+}
+
+TEST_F(Statement, executeReturnsChangesAndResets)
+{
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "INSERT INTO all_types (c_int, c_text) VALUES (?, ?)");
+    EXPECT_THAT(stmt.execute(1, std::string("one")), Eq(1));
+    EXPECT_THAT(stmt.execute(2, std::string("two")), Eq(1));
+
+    auto update = conn_.prepare("UPDATE all_types SET c_float = 1.0 WHERE c_int < 3");
+    EXPECT_THAT(update.execute(), Eq(2));
+}
+
+TEST_F(Statement, executeReturnsZeroForStatementsWithoutChanges)
+{
+    conn_.prepare("INSERT INTO all_types (c_int) VALUES (1)").execute();
+
+    EXPECT_THAT(conn_.prepare("SELECT 1 WHERE 0").execute(), Eq(0));
+    EXPECT_THAT(conn_.prepare("CREATE TABLE empty (id INT)").execute(), Eq(0));
+    EXPECT_THAT(conn_.prepare("DELETE FROM empty").execute(), Eq(0));
+}
+
+TEST_F(Statement, canBindStringLiterals)
+{
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "INSERT INTO all_types (c_int, c_text) VALUES (?, ?)");
+    EXPECT_THAT(stmt.execute(1, "one"), Eq(1));
+    stmt.bind(0, 2).bind(1, "two").execute();
+
+    const char *nullString = nullptr;
+    stmt.execute(3, nullString);
+
+    auto select = conn_.prepare(
+                "SELECT c_text FROM all_types WHERE c_int < 10 ORDER BY c_int");
+    std::vector<SmartSqlite::Nullable<std::string>> texts;
+    for (const auto &row : select)
+    {
+        texts.push_back(row.getNullable<std::string>(0));
+    }
+    ASSERT_THAT(texts.size(), Eq(3U));
+    EXPECT_THAT(*texts[0], Eq("one"));
+    EXPECT_THAT(*texts[1], Eq("two"));
+    EXPECT_THAT(static_cast<bool>(texts[2]), Eq(false));
+}
+
+TEST_F(Statement, executeIsUsableAfterFailure)
+{
+    conn_.exec("CREATE TABLE uniq (id INT UNIQUE)");
+    SmartSqlite::Statement stmt = conn_.prepare("INSERT INTO uniq VALUES (?)");
+    stmt.execute(1);
+    EXPECT_THROW(stmt.execute(1), SmartSqlite::SqliteException);
+    EXPECT_THAT(stmt.execute(2), Eq(1));
+}
+
+TEST(StaticSql, countsAnonymousParameters)
+{
+    static_assert(SmartSqlite::countParameters("SELECT 1") == 0, "");
+    static_assert(SmartSqlite::countParameters("SELECT ?, ?") == 2, "");
+    static_assert(SmartSqlite::countParameters("SELECT '?', \"?\", ?") == 1, "");
+    static_assert(SmartSqlite::countParameters("SELECT 'it''s', ?") == 1, "");
+}
+
+TEST(StaticSql, rejectsUnsupportedParameters)
+{
+    static_assert(SmartSqlite::countParameters("SELECT :name") == -1, "");
+    static_assert(SmartSqlite::countParameters("SELECT ?1") == -1, "");
+    static_assert(SmartSqlite::countParameters("SELECT 'unterminated") == -1, "");
+    static_assert(SmartSqlite::countParameters("SELECT ':name', ?") == 1, "");
+}
+
+TEST_F(Statement, canExecuteCheckedStatement)
+{
+    auto stmt = conn_.prepare(SMARTSQLITE_SQL(
+                "INSERT INTO all_types (c_int, c_text) VALUES (?, ?)"));
+    EXPECT_THAT(stmt.execute(1, std::string("one")), Eq(1));
+    EXPECT_THAT(stmt.bindAll(2, std::string("two")).execute(), Eq(1));
+}
+
+namespace {
+struct Temperature
+{
+    std::int64_t id;
+    std::string city;
+};
+}
+
+namespace SmartSqlite {
+template <>
+class Fields<Temperature>
+{
+public:
+    static std::tuple<const std::int64_t &, const std::string &> tie(const Temperature &value)
+    {
+        return std::tie(value.id, value.city);
+    }
+
+    static std::tuple<std::int64_t &, std::string &> tie(Temperature &value)
+    {
+        return std::tie(value.id, value.city);
+    }
+};
+}
+
+class StatementExecuteMany : public Statement
+{
+protected:
+    StatementExecuteMany()
+    {
+        conn_.exec("CREATE TABLE temperatures (id INTEGER PRIMARY KEY, city TEXT)");
+    }
+
+    int countTemperatures()
+    {
+        return conn_.prepare("SELECT count(*) FROM temperatures")
+                .execWithSingleResult().get<int>(0);
+    }
+};
+
+TEST_F(StatementExecuteMany, canExecuteTuples)
+{
+    std::vector<std::tuple<int, std::string>> rows = {
+        std::make_tuple(1, "Berlin"),
+        std::make_tuple(2, "New York"),
+    };
+    auto stmt = conn_.prepare("INSERT INTO temperatures VALUES (?, ?)");
+    EXPECT_THAT(stmt.executeMany(rows), Eq(2));
+    EXPECT_THAT(countTemperatures(), Eq(2));
+}
+
+TEST_F(StatementExecuteMany, canExecuteStructs)
+{
+    std::vector<Temperature> rows = {{1, "Berlin"}, {2, "New York"}, {3, "Cape Town"}};
+    auto stmt = conn_.prepare("INSERT INTO temperatures VALUES (?, ?)");
+    EXPECT_THAT(stmt.executeMany(rows, 2), Eq(3));
+    EXPECT_THAT(countTemperatures(), Eq(3));
+}
+
+TEST_F(StatementExecuteMany, throwsOnParameterCountMismatch)
+{
+    std::vector<std::pair<int, std::string>> rows = {{1, "Berlin"}};
+    auto stmt = conn_.prepare("INSERT INTO temperatures (id) VALUES (?)");
+    EXPECT_THROW(stmt.executeMany(rows), SmartSqlite::ParameterCountMismatch);
+}
+
+TEST_F(StatementExecuteMany, rollsBackFailedChunkOnly)
+{
+    std::vector<Temperature> rows = {{1, "Berlin"}, {2, "New York"}, {3, "Cape Town"}, {1, "Duplicate"}};
+    auto stmt = conn_.prepare("INSERT INTO temperatures VALUES (?, ?)");
+    EXPECT_THROW(stmt.executeMany(rows, 2), SmartSqlite::SqliteException);
+    EXPECT_THAT(countTemperatures(), Eq(2));
+
+    // the statement is still usable
+    std::vector<Temperature> moreRows = {{4, "Paris"}};
+    EXPECT_THAT(stmt.executeMany(moreRows), Eq(1));
+}
+
+TEST_F(StatementExecuteMany, joinsTransactionOfCaller)
+{
+    std::vector<Temperature> rows = {{1, "Berlin"}, {2, "New York"}};
+    auto stmt = conn_.prepare("INSERT INTO temperatures VALUES (?, ?)");
+    conn_.beginTransaction();
+    stmt.executeMany(rows, 1);
+    conn_.rollbackTransaction();
+    EXPECT_THAT(countTemperatures(), Eq(0));
+}
+
+TEST_F(Statement, tryBindReturnsResultCode)
+{
+    SmartSqlite::Statement stmt = makeSelect();
+    EXPECT_THAT(stmt.tryBind(0, 42), Eq(SQLITE_OK));
+    EXPECT_THAT(stmt.tryBind(1, std::string("x")), Eq(SQLITE_RANGE));
+    EXPECT_THAT(stmt.tryBindNull(5), Eq(SQLITE_RANGE));
+}
+
+TEST_F(Statement, canStepWithoutExceptions)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT c_int FROM all_types ORDER BY c_int");
+    std::vector<bool> nulls;
+    int result;
+    while ((result = stmt.tryStep()) == SQLITE_ROW)
+    {
+        nulls.push_back(stmt.row().isNull(0));
+    }
+    EXPECT_THAT(result, Eq(SQLITE_DONE));
+    EXPECT_THAT(nulls, ElementsAre(true, false));
+    EXPECT_THROW(stmt.row().get<int>("c_int"), SmartSqlite::ColumnUnknown);
+
+    EXPECT_THAT(stmt.tryReset(), Eq(SQLITE_OK));
+    EXPECT_THAT(stmt.tryStep(), Eq(SQLITE_ROW));
+}
+
+TEST_F(Statement, tryExecuteReturnsErrorCode)
+{
+    conn_.exec("CREATE TABLE unique_values (value INTEGER UNIQUE)");
+    SmartSqlite::Statement stmt = conn_.prepare("INSERT INTO unique_values VALUES (?)");
+    stmt.bind(0, 1);
+    EXPECT_THAT(stmt.tryExecute(), Eq(SQLITE_OK));
+    int result = stmt.tryExecute();
+    EXPECT_THAT(result, Eq(SQLITE_CONSTRAINT_UNIQUE));
+    EXPECT_THAT(result & 0xff, Eq(SQLITE_CONSTRAINT));
+    EXPECT_THAT(stmt.errorMessage(), HasSubstr("UNIQUE constraint failed"));
+
+    stmt.bind(0, 2);
+    EXPECT_THAT(stmt.tryExecute(), Eq(SQLITE_OK));
+    EXPECT_THAT(makeSelectAll().tryExecute(), Eq(SQLITE_ROW));
+}
+
+TEST_F(Statement, canIterateTypedRows)
+{
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "SELECT c_int, c_text, c_float FROM all_types ORDER BY c_int DESC");
+    std::vector<std::tuple<std::int64_t, std::string, double>> result;
+    for (const auto &row : stmt.rows<std::int64_t, std::string, double>())
+    {
+        result.push_back(row);
+    }
+    ASSERT_THAT(result.size(), Eq(2u));
+    EXPECT_THAT(result[0], Eq(std::make_tuple(std::int64_t(42), std::string("6*7"), 2.0)));
+    EXPECT_THAT(result[1], Eq(std::make_tuple(std::int64_t(0), std::string(), 0.0)));
+}
+
+TEST_F(Statement, canIterateTypedRowsWithNullables)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT c_int FROM all_types ORDER BY c_int");
+    std::vector<SmartSqlite::Nullable<int>> result;
+    for (const auto &row : stmt.rows<SmartSqlite::Nullable<int>>())
+    {
+        result.push_back(std::get<0>(row));
+    }
+    EXPECT_THAT(result, ElementsAre(SmartSqlite::Nullable<int>(),
+                                    SmartSqlite::Nullable<int>(42)));
+}
+
+TEST_F(Statement, typedRowsThrowOnColumnCountMismatch)
+{
+    SmartSqlite::Statement stmt = makeSelectAll();
+    EXPECT_THROW(stmt.rows<int>(), SmartSqlite::ColumnCountMismatch);
+
+    // the statement is still usable
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(42));
+}
+
+TEST_F(StatementExecuteMany, canIterateStructs)
+{
+    std::vector<Temperature> rows = {{1, "Berlin"}, {2, "New York"}};
+    conn_.prepare("INSERT INTO temperatures VALUES (?, ?)").executeMany(rows);
+
+    auto stmt = conn_.prepare("SELECT id, city FROM temperatures ORDER BY id");
+    std::vector<std::string> cities;
+    for (const auto &temperature : stmt.rowsAs<Temperature>())
+    {
+        EXPECT_THAT(temperature.id, Eq(static_cast<std::int64_t>(cities.size() + 1)));
+        cities.push_back(temperature.city);
+    }
+    EXPECT_THAT(cities, ElementsAre("Berlin", "New York"));
+}
+
+TEST_F(Statement, canFetchColumnBatches)
+{
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "SELECT c_int, c_float, c_text, c_blob, 'x' || c_int AS expr "
+                "FROM all_types ORDER BY c_int DESC");
+
+    auto batch = stmt.fetchColumns(8);
+    ASSERT_THAT(batch.rows(), Eq(2u));
+    ASSERT_THAT(batch.columnCount(), Eq(5u));
+
+    const auto &ints = batch.column(0);
+    EXPECT_THAT(ints.type(), Eq(SmartSqlite::ColumnBatch::Type::Int64));
+    EXPECT_THAT(ints.name(), Eq("c_int"));
+    EXPECT_THAT(ints.int64s(), ElementsAre(42, 0));
+    EXPECT_THAT(ints.isNull(0), Eq(false));
+    EXPECT_THAT(ints.isNull(1), Eq(true));
+
+    const auto &floats = batch.column(1);
+    EXPECT_THAT(floats.type(), Eq(SmartSqlite::ColumnBatch::Type::Double));
+    EXPECT_THAT(floats.doubles(), ElementsAre(2.0, 0.0));
+
+    const auto &texts = batch.column(2);
+    EXPECT_THAT(texts.type(), Eq(SmartSqlite::ColumnBatch::Type::Text));
+    EXPECT_THAT(texts.offsets(), ElementsAre(0u, 3u, 3u));
+    EXPECT_THAT(texts.text(0).toString(), Eq("6*7"));
+    EXPECT_THAT(texts.nullBitmap(), ElementsAre(2u));
+
+    const auto &blobs = batch.column(3);
+    EXPECT_THAT(blobs.type(), Eq(SmartSqlite::ColumnBatch::Type::Blob));
+    EXPECT_THAT(blobs.blob(0).toVector(), Eq(exampleBlob()));
+    EXPECT_THAT(blobs.blob(1).empty(), Eq(true));
+
+    // type of expressions is taken from the first value
+    EXPECT_THAT(batch.column(4).type(), Eq(SmartSqlite::ColumnBatch::Type::Text));
+
+    EXPECT_THAT(stmt.fetchColumns(batch, 8), Eq(0u));
+}
+
+TEST_F(Statement, fetchColumnsContinuesWithNextBatch)
+{
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < 10) "
+                "SELECT n FROM seq");
+    SmartSqlite::ColumnBatch batch;
+    std::vector<std::int64_t> values;
+    while (stmt.fetchColumns(batch, 4) > 0)
+    {
+        const auto &batchValues = batch.column(0).int64s();
+        values.insert(values.end(), batchValues.begin(), batchValues.end());
+    }
+    EXPECT_THAT(values, ElementsAre(1, 2, 3, 4, 5, 6, 7, 8, 9, 10));
+
+    // after a reset, the statement runs again
+    stmt.reset();
+    EXPECT_THAT(stmt.fetchColumns(batch, 100), Eq(10u));
+}
+
+TEST_F(Statement, fetchColumnsInfersTypeAfterLeadingNulls)
+{
+    SmartSqlite::Statement stmt = conn_.prepare(
+                "SELECT c_int + 1 AS expr FROM all_types ORDER BY c_int");
+
+    auto batch = stmt.fetchColumns(8);
+    ASSERT_THAT(batch.rows(), Eq(2u));
+    const auto &column = batch.column(0);
+    EXPECT_THAT(column.type(), Eq(SmartSqlite::ColumnBatch::Type::Int64));
+    EXPECT_THAT(column.int64s(), ElementsAre(0, 43));
+    EXPECT_THAT(column.isNull(0), Eq(true));
+    EXPECT_THAT(column.isNull(1), Eq(false));
+}
+
+TEST_F(Statement, fetchColumnsResetsColumnsOfOtherStatements)
+{
+    SmartSqlite::ColumnBatch batch;
+    auto ints = conn_.prepare("SELECT c_int FROM all_types WHERE c_int IS NOT NULL");
+    ints.fetchColumns(batch, 8);
+    EXPECT_THAT(batch.column(0).type(), Eq(SmartSqlite::ColumnBatch::Type::Int64));
+
+    // same number of columns, but a different name and type
+    auto texts = conn_.prepare("SELECT c_text FROM all_types WHERE c_text IS NOT NULL");
+    texts.fetchColumns(batch, 8);
+    EXPECT_THAT(batch.column(0).name(), Eq("c_text"));
+    EXPECT_THAT(batch.column(0).type(), Eq(SmartSqlite::ColumnBatch::Type::Text));
+    EXPECT_THAT(batch.column(0).text(0).toString(), Eq("6*7"));
+}
+
+TEST_F(Statement, fetchColumnsResetsColumnsOnEmptyResult)
+{
+    SmartSqlite::ColumnBatch batch;
+    auto ints = conn_.prepare("SELECT c_int FROM all_types WHERE c_int IS NOT NULL");
+    ints.fetchColumns(batch, 8);
+
+    auto empty = conn_.prepare("SELECT c_text, c_blob FROM all_types WHERE 0");
+    EXPECT_THAT(empty.fetchColumns(batch, 8), Eq(0u));
+    ASSERT_THAT(batch.columnCount(), Eq(2u));
+    EXPECT_THAT(batch.column(0).name(), Eq("c_text"));
+    EXPECT_THAT(batch.column(1).name(), Eq("c_blob"));
+    EXPECT_THAT(batch.column(0).type(), Eq(SmartSqlite::ColumnBatch::Type::Text));
+}
+
+class StatementCarray : public Statement
+{
+protected:
+    StatementCarray()
+    {
+        conn_.exec("CREATE TABLE numbers (id INTEGER PRIMARY KEY, name TEXT, value REAL)");
+        conn_.exec("INSERT INTO numbers VALUES (1, 'one', 1.5), (2, 'two', 2.5), (3, 'three', 3.5)");
+    }
+
+    std::vector<int> selectIds(SmartSqlite::Statement &stmt)
+    {
+        std::vector<int> ids;
+        for (auto iter = stmt.begin(); iter != stmt.end(); ++iter)
+        {
+            ids.push_back(iter->get<int>(0));
+        }
+        stmt.reset();
+        return ids;
+    }
+};
+
+TEST_F(StatementCarray, canBindInt64Array)
+{
+    std::vector<std::int64_t> ids = {1, 3, 42};
+    auto stmt = conn_.prepare("SELECT id FROM numbers WHERE id IN carray(?) ORDER BY id");
+    stmt.bind(0, ids);
+    EXPECT_THAT(selectIds(stmt), ElementsAre(1, 3));
+}
+
+TEST_F(StatementCarray, canBindArraysOfAnySize)
+{
+    auto stmt = conn_.prepare("SELECT id FROM numbers WHERE id IN carray(?) ORDER BY id");
+    stmt.bind(0, std::vector<std::int64_t>{2});
+    EXPECT_THAT(selectIds(stmt), ElementsAre(2));
+    stmt.bind(0, std::vector<std::int64_t>{3, 2, 1});
+    EXPECT_THAT(selectIds(stmt), ElementsAre(1, 2, 3));
+    stmt.bind(0, std::vector<std::int64_t>());
+    EXPECT_THAT(selectIds(stmt), IsEmpty());
+}
+
+TEST_F(StatementCarray, canBindDoubleArray)
+{
+    std::vector<double> values = {2.5, 3.5};
+    auto stmt = conn_.prepare("SELECT id FROM numbers WHERE value IN carray(?) ORDER BY id");
+    stmt.bind(0, values);
+    EXPECT_THAT(selectIds(stmt), ElementsAre(2, 3));
+}
+
+TEST_F(StatementCarray, canBindTextArray)
+{
+    auto stmt = conn_.prepare("SELECT id FROM numbers WHERE name IN carray(?) ORDER BY id");
+    stmt.bind(0, std::vector<std::string>{"one", "three", "four"});
+    EXPECT_THAT(selectIds(stmt), ElementsAre(1, 3));
+}
+
+TEST_F(StatementCarray, canSelectFromCarray)
+{
+    std::vector<std::string> names = {"a", "b"};
+    auto stmt = conn_.prepare("SELECT group_concat(value, ',') FROM carray(?)");
+    stmt.bindAll(names);
+    EXPECT_THAT(stmt.execWithSingleResult().get<std::string>(0), Eq("a,b"));
+}
+
+#ifndef NDEBUG
+TEST_F(StatementCarray, detectsModifiedBorrowedArray)
+{
+    std::vector<std::int64_t> ids = {1, 3};
+    auto stmt = conn_.prepare("SELECT id FROM numbers WHERE id IN carray(?) ORDER BY id");
+    stmt.bind(0, ids);
+    ids[0] = 2;
+    EXPECT_THROW(stmt.begin(), SmartSqlite::BorrowedBindingModified);
+}
+
+TEST_F(StatementCarray, detectsModifiedBorrowedTextArray)
+{
+    std::vector<std::string> names = {"one", "two"};
+    auto stmt = conn_.prepare("SELECT id FROM numbers WHERE name IN carray(?) ORDER BY id");
+    stmt.bindAll(names);
+    EXPECT_THAT(selectIds(stmt), ElementsAre(1, 2));
+    names[1] = "three";
+    EXPECT_THROW(stmt.begin(), SmartSqlite::BorrowedBindingModified);
+}
+#endif
+
+TEST_F(StatementCarray, isEmptyWithoutBinding)
+{
+    auto stmt = conn_.prepare("SELECT count(*) FROM carray(?)");
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(0));
+}
+
+TEST_F(Statement, canBindManyParametersByName)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT :c, :a, @b, $d, :a");
+    stmt.bind(":a", 1);
+    stmt.bind("@b", 2);
+    stmt.bind(":c", 3);
+    stmt.bind("$d", 4);
+    auto row = stmt.execWithSingleResult();
+    EXPECT_THAT(row.get<int>(0), Eq(3));
+    EXPECT_THAT(row.get<int>(1), Eq(1));
+    EXPECT_THAT(row.get<int>(2), Eq(2));
+    EXPECT_THAT(row.get<int>(3), Eq(4));
+    EXPECT_THAT(row.get<int>(4), Eq(1));
+}
+
+TEST_F(Statement, bindThrowsOnUnknownParameterName)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT ?, :a");
+    EXPECT_THROW(stmt.bind(":b", 1), SmartSqlite::ParameterUnknown);
+    EXPECT_THROW(stmt.bind("a", 1), SmartSqlite::ParameterUnknown);
+}
+
+TEST_F(Statement, canBindViaResolvedParameter)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT :a, :b");
+    auto paramB = stmt.parameter(":b");
+    EXPECT_THAT(paramB.pos(), Eq(1));
+    stmt.bind(paramB, std::string("b"));
+    EXPECT_THAT(stmt.execWithSingleResult().get<std::string>(1), Eq("b"));
+    EXPECT_THROW(stmt.parameter(":c"), SmartSqlite::ParameterUnknown);
+}
+
+TEST_F(Statement, cachedStatementKeepsParameterIndex)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        auto stmt = conn_.prepareCached("SELECT :value");
+        stmt.bind(":value", i);
+        EXPECT_THAT(stmt.execWithSingleResult().get<int>(0), Eq(i));
+    }
+}
+
+TEST_F(Statement, canGetColumnMetadata)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT c_int, c_text AS t, 1 + 1 FROM all_types");
+    EXPECT_THAT(stmt.columnCount(), Eq(3));
+    EXPECT_THAT(stmt.columnName(0), Eq("c_int"));
+    EXPECT_THAT(stmt.columnName(1), Eq("t"));
+    EXPECT_THAT(stmt.columnDeclaredType(0), Eq("INT"));
+    EXPECT_THAT(stmt.columnDeclaredType(1), Eq("TEXT"));
+    EXPECT_THAT(stmt.columnDeclaredType(2), Eq(""));
+    EXPECT_THROW(stmt.columnName(3), SmartSqlite::ColumnUnknown);
+}
+
+TEST_F(Statement, getByUnknownNameThrows)
+{
+    SmartSqlite::Statement stmt = makeSelectAll();
+    EXPECT_THROW(stmt.begin()->get<int>("c_unknown"), SmartSqlite::ColumnUnknown);
+}
+
+TEST_F(Statement, getByDuplicateNameReturnsLastColumn)
+{
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT 1 AS a, 2 AS a");
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>("a"), Eq(2));
+}
+
+TEST_F(Statement, columnsAreUpdatedAfterSchemaChange)
+{
+    conn_.exec("CREATE TABLE growing (a INT)");
+    conn_.exec("INSERT INTO growing VALUES (1)");
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT * FROM growing");
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>("a"), Eq(1));
+    stmt.reset();
+
+    conn_.exec("ALTER TABLE growing ADD COLUMN b INT DEFAULT 2");
+    auto row = stmt.execWithSingleResult();
+    EXPECT_THAT(row.get<int>("b"), Eq(2));
+}
+
+TEST_F(Statement, columnsAreUpdatedAfterColumnsAreReordered)
+{
+    conn_.exec("CREATE TABLE reordered (a INT, b INT)");
+    conn_.exec("INSERT INTO reordered VALUES (1, 2)");
+    SmartSqlite::Statement stmt = conn_.prepare("SELECT * FROM reordered");
+    EXPECT_THAT(stmt.execWithSingleResult().get<int>("a"), Eq(1));
+    stmt.reset();
+
+    // same number of columns, but in a different order
+    conn_.exec("DROP TABLE reordered");
+    conn_.exec("CREATE TABLE reordered (b INT, a INT)");
+    conn_.exec("INSERT INTO reordered VALUES (2, 1)");
+    auto row = stmt.execWithSingleResult();
+    EXPECT_THAT(row.get<int>("a"), Eq(1));
+    EXPECT_THAT(row.get<int>("b"), Eq(2));
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2014–2020 Kullo GmbH
+ *
+ * This source code is licensed under the 3-clause BSD license. See LICENSE.txt
+ * in the root directory of this source tree for details.
+ */
+#include <gmock/gmock.h>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "smartsqlite/exceptions.h"
+#include "smartsqlite/writequeue.h"
+
+using namespace testing;
+
+class WriteQueue : public Test
+{
+protected:
+    void open(SmartSqlite::WriteQueueOptions options = SmartSqlite::WriteQueueOptions())
+    {
+        options.setup = [](SmartSqlite::Connection &conn) {
+            conn.exec("CREATE TABLE events (id INTEGER PRIMARY KEY, name TEXT)");
+        };
+        queue_.reset(new SmartSqlite::WriteQueue(":memory:", options));
+    }
+
+    int countEvents()
+    {
+        return queue_->submit([](SmartSqlite::Connection &conn) {
+            return conn.prepare("SELECT count(*) FROM events")
+                    .execWithSingleResult().get<int>(0);
+        }).get();
+    }
+
+    std::unique_ptr<SmartSqlite::WriteQueue> queue_;
+};
+
+TEST_F(WriteQueue, throwsIfSetupThrows)
+{
+    SmartSqlite::WriteQueueOptions options;
+    options.setup = [](SmartSqlite::Connection &conn) {
+        conn.exec("no valid sql");
+    };
+    EXPECT_THROW(SmartSqlite::WriteQueue(":memory:", options),
+                 SmartSqlite::SqliteException);
+}
+
+TEST_F(WriteQueue, executeReturnsChanges)
+{
+    open();
+    auto changes = queue_->execute("INSERT INTO events (name) VALUES (?)",
+                                   std::string("start"));
+    EXPECT_THAT(changes.get(), Eq(1));
+    EXPECT_THAT(countEvents(), Eq(1));
+}
+
+TEST_F(WriteQueue, coalescesWritesFromManyThreads)
+{
+    SmartSqlite::WriteQueueOptions options;
+    options.maxLatency = std::chrono::milliseconds(20);
+    open(options);
+
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; ++t)
+    {
+        producers.emplace_back([this] {
+            std::vector<std::future<int>> results;
+            for (int i = 0; i < 25; ++i)
+            {
+                results.push_back(queue_->execute(
+                                      "INSERT INTO events (name) VALUES (?)",
+                                      std::string("event")));
+            }
+            for (auto &result : results) EXPECT_THAT(result.get(), Eq(1));
+        });
+    }
+    for (auto &producer : producers) producer.join();
+
+    EXPECT_THAT(countEvents(), Eq(100));
+    auto stats = queue_->stats();
+    EXPECT_THAT(stats.failedWrites, Eq(0u));
+    EXPECT_THAT(stats.batches, Lt(stats.writes));
+}
+
+TEST_F(WriteQueue, failingWriteOnlyRollsBackItself)
+{
+    SmartSqlite::WriteQueueOptions options;
+    options.maxBatchSize = 3;
+    options.maxLatency = std::chrono::milliseconds(200);
+    open(options);
+
+    auto first = queue_->execute("INSERT INTO events (name) VALUES ('first')");
+    auto failing = queue_->submit([](SmartSqlite::Connection &conn) {
+        conn.exec("INSERT INTO events (name) VALUES ('failing')");
+        throw std::runtime_error("abort");
+    });
+    auto last = queue_->execute("INSERT INTO events (name) VALUES ('last')");
+
+    EXPECT_THAT(first.get(), Eq(1));
+    EXPECT_THROW(failing.get(), std::runtime_error);
+    EXPECT_THAT(last.get(), Eq(1));
+    EXPECT_THAT(countEvents(), Eq(2));
+
+    auto stats = queue_->stats();
+    EXPECT_THAT(stats.largestBatch, Eq(3u));
+    EXPECT_THAT(stats.failedWrites, Eq(1u));
+}
+
+TEST_F(WriteQueue, writeRollingBackTransactionFailsEarlierWrites)
+{
+    SmartSqlite::WriteQueueOptions options;
+    options.maxBatchSize = 3;
+    options.maxLatency = std::chrono::milliseconds(200);
+    open(options);
+    queue_->execute("INSERT INTO events (id, name) VALUES (1, 'existing')").get();
+
+    auto first = queue_->execute("INSERT INTO events (name) VALUES ('first')");
+    // the constraint violation rolls back the whole transaction
+    auto failing = queue_->execute("INSERT OR ROLLBACK INTO events (id, name) VALUES (1, 'duplicate')");
+    auto last = queue_->execute("INSERT INTO events (name) VALUES ('last')");
+
+    EXPECT_THROW(first.get(), SmartSqlite::Exception);
+    EXPECT_THROW(failing.get(), SmartSqlite::SqliteException);
+    EXPECT_THAT(last.get(), Eq(1));
+
+    auto names = queue_->submit([](SmartSqlite::Connection &conn) {
+        std::vector<std::string> names;
+        auto stmt = conn.prepare("SELECT name FROM events ORDER BY id");
+        for (const auto &row : stmt) names.push_back(row.get<std::string>(0));
+        return names;
+    }).get();
+    EXPECT_THAT(names, ElementsAre("existing", "last"));
+    EXPECT_THAT(queue_->stats().failedWrites, Eq(2u));
+}
+
+TEST_F(WriteQueue, respectsMaxBatchSize)
+{
+    SmartSqlite::WriteQueueOptions options;
+    options.maxBatchSize = 2;
+    options.maxLatency = std::chrono::milliseconds(5);
+    open(options);
+
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 7; ++i)
+    {
+        results.push_back(queue_->execute("INSERT INTO events DEFAULT VALUES"));
+    }
+    for (auto &result : results) result.get();
+
+    auto stats = queue_->stats();
+    EXPECT_THAT(stats.largestBatch, Le(2u));
+    EXPECT_THAT(stats.batches, Ge(4u));
+}
+
+TEST_F(WriteQueue, destructorCommitsQueuedWrites)
+{
+    SmartSqlite::WriteQueueOptions options;
+    options.maxLatency = std::chrono::seconds(10);
+    open(options);
+
+    std::future<int> last;
+    for (int i = 0; i < 10; ++i)
+    {
+        last = queue_->execute("INSERT INTO events DEFAULT VALUES");
+    }
+    queue_.reset();
+    EXPECT_THAT(last.wait_for(std::chrono::seconds(0)), Eq(std::future_status::ready));
+    EXPECT_THAT(last.get(), Eq(1));
+}